@@ -8,11 +8,19 @@
 #include "threads/thread.h"
 #ifdef USERPROG
 #include "userprog/exception.h"
+#include "userprog/pagedir.h"
 #endif
 #ifdef FILESYS
 #include "devices/block.h"
 #include "filesys/filesys.h"
 #endif
+#ifdef VM
+#include "vm/faultstat.h"
+#include "vm/frame.h"
+#include "vm/page.h"
+#include "vm/swap.h"
+#include "vm/vmstat.h"
+#endif
 
 /* Keyboard control register port. */
 #define CONTROL_REG 0x64
@@ -137,5 +145,13 @@ print_stats(void)
     kbd_print_stats();
 #ifdef USERPROG
     exception_print_stats();
+    pagedir_print_stats();
+#endif
+#ifdef VM
+    frame_print_stats();
+    page_print_stats();
+    swap_print_stats();
+    vmstat_print_stats();
+    faultstat_print_stats();
 #endif
 }
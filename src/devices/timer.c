@@ -86,6 +86,16 @@ timer_elapsed(int64_t then)
     return timer_ticks() - then;
 }
 
+/* Returns the CPU time-stamp counter, for measuring intervals
+   much shorter than a timer tick. */
+uint64_t
+timer_cycles(void)
+{
+    uint64_t tsc;
+    asm volatile("rdtsc" : "=A"(tsc));
+    return tsc;
+}
+
 /* Sleeps for approximately TICKS timer ticks. The current
    thread is put to sleep and wakes up later in
    timer_interrupt(). Interrupts must be turned on. */
@@ -0,0 +1,55 @@
+/* forkbench.c
+
+   Measures the cost of creating processes.  Runs COUNT rounds of
+   either fork() + exit() or exec() + exit(), waiting for each
+   child before starting the next:
+
+        forkbench fork 100
+        forkbench exec 100
+
+   User programs have no clock, so compare the "Timer: N ticks"
+   line that the kernel prints at shutdown between the two modes
+   (run with -q). */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <syscall.h>
+
+int main(int argc, char *argv[])
+{
+    int count, i;
+
+    if (argc == 2 && !strcmp(argv[1], "child"))
+        return 0;
+
+    if (argc != 3)
+    {
+        printf("usage: forkbench fork|exec <count>\n");
+        return EXIT_FAILURE;
+    }
+
+    count = atoi(argv[2]);
+    for (i = 0; i < count; i++)
+    {
+        pid_t pid;
+
+        if (!strcmp(argv[1], "fork"))
+        {
+            pid = fork();
+            if (pid == 0)
+                exit(0);
+        }
+        else
+            pid = exec("forkbench child");
+
+        if (pid == PID_ERROR || wait(pid) != 0)
+        {
+            printf("forkbench: round %d failed\n", i);
+            return EXIT_FAILURE;
+        }
+    }
+
+    printf("forkbench: %d rounds of %s + exit\n", count, argv[1]);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,197 @@
+/* shmbench.c
+
+   Compares passing data between processes through shared memory
+   with passing it through a file.  A producer and a consumer,
+   forked from it, move KBYTES of data through a ring of RING_CNT
+   4 kB blocks, either held in a shared memory segment that both
+   map or stored in a file that the producer write()s and the
+   consumer read()s:
+
+        shmbench shm 4096
+        shmbench file 4096
+
+   Either way the ring's head and tail live in a shared anonymous
+   mapping, and each side spins while the ring is full or empty.
+   The consumer checks every block it takes.
+
+   User programs have no clock, so compare the "Timer: N ticks"
+   line that the kernel prints at shutdown between the two modes
+   (run with -q). */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <syscall.h>
+
+#define BLOCK 4096
+#define RING_CNT 8
+
+/* Ring state, shared by producer and consumer. */
+struct control
+{
+    volatile unsigned head;     /* Blocks produced. */
+    volatile unsigned tail;     /* Blocks consumed. */
+};
+
+static const char *file_name = "shmbench.dat";
+
+/* Fills BUF with the contents of block N. */
+static void fill(unsigned *buf, unsigned n)
+{
+    size_t i;
+
+    for (i = 0; i < BLOCK / sizeof *buf; i++)
+        buf[i] = n * 2654435761u + i;
+}
+
+/* Returns true if BUF holds the contents of block N. */
+static bool check(const unsigned *buf, unsigned n)
+{
+    size_t i;
+
+    for (i = 0; i < BLOCK / sizeof *buf; i++)
+        if (buf[i] != n * 2654435761u + i)
+            return false;
+    return true;
+}
+
+/* Takes BLOCK_CNT blocks from the ring, from RING if it is not
+   null, else from file FD, and returns the number that were
+   wrong. */
+static int consume(struct control *ctl, char *ring, int fd, unsigned block_cnt)
+{
+    static unsigned buf[BLOCK / sizeof (unsigned)];
+    int bad = 0;
+    unsigned n;
+
+    for (n = 0; n < block_cnt; n++)
+    {
+        unsigned slot = n % RING_CNT;
+
+        while (ctl->head == n)
+            continue;
+        if (ring != NULL)
+            bad += !check((const unsigned *) (ring + slot * BLOCK), n);
+        else
+        {
+            seek(fd, slot * BLOCK);
+            bad += read(fd, buf, BLOCK) != BLOCK || !check(buf, n);
+        }
+        ctl->tail = n + 1;
+    }
+    return bad;
+}
+
+/* Puts BLOCK_CNT blocks into the ring, into RING if it is not
+   null, else into file FD. */
+static void produce(struct control *ctl, char *ring, int fd, unsigned block_cnt)
+{
+    static unsigned buf[BLOCK / sizeof (unsigned)];
+    unsigned n;
+
+    for (n = 0; n < block_cnt; n++)
+    {
+        unsigned slot = n % RING_CNT;
+
+        while (n - ctl->tail == RING_CNT)
+            continue;
+        if (ring != NULL)
+            fill((unsigned *) (ring + slot * BLOCK), n);
+        else
+        {
+            fill(buf, n);
+            seek(fd, slot * BLOCK);
+            write(fd, buf, BLOCK);
+        }
+        ctl->head = n + 1;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    struct control *ctl;
+    char *ring = NULL;
+    bool use_shm;
+    unsigned block_cnt;
+    int fd, status;
+    pid_t pid;
+
+    if (argc != 3 || (strcmp(argv[1], "shm") && strcmp(argv[1], "file"))
+        || atoi(argv[2]) <= 0)
+    {
+        printf("usage: shmbench shm|file <kbytes>\n");
+        return EXIT_FAILURE;
+    }
+    use_shm = !strcmp(argv[1], "shm");
+    block_cnt = atoi(argv[2]) / (BLOCK / 1024);
+
+    ctl = mmap2(NULL, sizeof *ctl, PROT_READ | PROT_WRITE,
+                MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (ctl == NULL)
+    {
+        printf("shmbench: mmap2 failed\n");
+        return EXIT_FAILURE;
+    }
+
+    if (use_shm)
+    {
+        shm_unlink("shmbench");
+        fd = shm_open("shmbench", SHM_CREAT | SHM_EXCL, RING_CNT * BLOCK);
+    }
+    else
+    {
+        remove(file_name);
+        fd = create(file_name, RING_CNT * BLOCK) ? open(file_name) : -1;
+    }
+    if (fd < 0)
+    {
+        printf("shmbench: can't create the ring\n");
+        return EXIT_FAILURE;
+    }
+
+    pid = fork();
+    if (pid == 0)
+    {
+        /* The consumer finds the segment by name, like an
+           unrelated process would. */
+        if (use_shm)
+        {
+            int seg = shm_open("shmbench", 0, 0);
+            ring = seg < 0 ? NULL : mmap2(NULL, RING_CNT * BLOCK, PROT_READ,
+                                          MAP_SHARED, seg, 0);
+            if (ring == NULL)
+                exit(-1);
+        }
+        exit(consume(ctl, ring, fd, block_cnt));
+    }
+    if (pid == PID_ERROR)
+    {
+        printf("shmbench: fork failed\n");
+        return EXIT_FAILURE;
+    }
+
+    if (use_shm)
+    {
+        ring = mmap2(NULL, RING_CNT * BLOCK, PROT_READ | PROT_WRITE,
+                     MAP_SHARED, fd, 0);
+        if (ring == NULL)
+        {
+            printf("shmbench: mmap2 failed\n");
+            return EXIT_FAILURE;
+        }
+    }
+    produce(ctl, ring, fd, block_cnt);
+    status = wait(pid);
+
+    if (use_shm)
+        shm_unlink("shmbench");
+    else
+        remove(file_name);
+    if (status != 0)
+    {
+        printf("shmbench: consumer failed (%d)\n", status);
+        return EXIT_FAILURE;
+    }
+    printf("shmbench: %u kB through %s\n", block_cnt * (BLOCK / 1024), argv[1]);
+    return EXIT_SUCCESS;
+}
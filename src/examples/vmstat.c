@@ -0,0 +1,98 @@
+/* vmstat.c
+
+   Reports system-wide virtual memory activity.  Takes COUNT
+   samples of the kernel's counters and prints one line per
+   sample with what changed since the previous one, optionally
+   while running COMMAND alongside:
+
+        vmstat 10
+        vmstat 10 page-merge-par
+
+   Columns are resident pages, swap slots in use, page faults
+   (all, minor, major and stack growth), pages swapped in and
+   out, evictions, writebacks and turns of the clock hand.
+
+   User programs have no clock or sleep, so samples are spaced
+   by a busy loop rather than by time. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <syscall.h>
+
+/* Iterations of the busy loop between samples. */
+#define SPIN 20000000
+
+static void spin(void)
+{
+    volatile int i;
+
+    for (i = 0; i < SPIN; i++)
+        continue;
+}
+
+static long long evictions(const struct vmstat *st)
+{
+    long long sum = 0;
+    int i;
+
+    for (i = 0; i < VMSTAT_TYPES; i++)
+        sum += st->evictions[i];
+    return sum;
+}
+
+int main(int argc, char *argv[])
+{
+    struct vmstat prev, cur;
+    pid_t pid = PID_ERROR;
+    int count, i;
+
+    if (argc < 2 || (count = atoi(argv[1])) <= 0)
+    {
+        printf("usage: vmstat <count> [command...]\n");
+        return EXIT_FAILURE;
+    }
+
+    if (argc > 2)
+    {
+        char cmd[128];
+        int n = 0;
+
+        cmd[0] = '\0';
+        for (i = 2; i < argc; i++)
+            n += snprintf(cmd + n, n < (int) sizeof cmd ? sizeof cmd - n : 0,
+                          "%s%s", i > 2 ? " " : "", argv[i]);
+        pid = exec(cmd);
+        if (pid == PID_ERROR)
+        {
+            printf("vmstat: %s: exec failed\n", cmd);
+            return EXIT_FAILURE;
+        }
+    }
+
+    printf("%6s %6s %7s %7s %7s %5s %6s %6s %6s %6s %5s\n",
+           "res", "swpd", "flt", "min", "maj", "stk",
+           "si", "so", "ev", "wb", "turns");
+    vmstat(VMSTAT_SYSTEM, &prev);
+    for (i = 0; i < count; i++)
+    {
+        spin();
+        vmstat(VMSTAT_SYSTEM, &cur);
+        printf("%6d %6d %7lld %7lld %7lld %5lld %6lld %6lld %6lld %6lld %5lld\n",
+               cur.resident, cur.swap_used,
+               cur.faults - prev.faults,
+               cur.minor_faults - prev.minor_faults,
+               cur.major_faults - prev.major_faults,
+               cur.stack_faults - prev.stack_faults,
+               cur.swap_ins - prev.swap_ins,
+               cur.swap_outs - prev.swap_outs,
+               evictions(&cur) - evictions(&prev),
+               cur.writebacks - prev.writebacks,
+               cur.clock_turns - prev.clock_turns);
+        prev = cur;
+    }
+
+    if (pid != PID_ERROR)
+        wait(pid);
+    return EXIT_SUCCESS;
+}
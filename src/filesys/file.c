@@ -133,6 +133,14 @@ void file_allow_write(struct file *file)
     }
 }
 
+/* Returns true if FILE denies writes to its inode, so that no
+   one can write to it while FILE stays open. */
+bool file_denies_write(struct file *file)
+{
+    ASSERT(file != NULL);
+    return file->deny_write;
+}
+
 /* Returns the size of FILE in bytes. */
 off_t file_length(struct file *file)
 {
@@ -28,7 +28,22 @@ enum
     SYS_MKDIR,   /* Create a directory. */
     SYS_READDIR, /* Reads a directory entry. */
     SYS_ISDIR,   /* Tests if a fd represents a directory. */
-    SYS_INUMBER  /* Returns the inode number for a fd. */
+    SYS_INUMBER, /* Returns the inode number for a fd. */
+
+    /* Extensions. */
+    SYS_FORK,    /* Clone the current process. */
+    SYS_MMAP2,   /* Map anonymous memory or part of a file. */
+    SYS_MUNMAP2, /* Unmap a range of memory. */
+    SYS_MPROTECT, /* Change the protection of a range of memory. */
+    SYS_MADVISE, /* Advise how a range of memory will be used. */
+    SYS_MSYNC,   /* Write a range of a file mapping back. */
+    SYS_SETRSS,  /* Set resident memory limits. */
+    SYS_GETRSS,  /* Count the caller's resident pages. */
+    SYS_VMSTAT,  /* Read virtual memory statistics. */
+    SYS_WSS,     /* Estimate the caller's working set. */
+    SYS_FAULTSTAT, /* Read page fault latency statistics. */
+    SYS_SHM_OPEN, /* Open a shared memory segment. */
+    SYS_SHM_UNLINK /* Remove a shared memory segment's name. */
 };
 
 #endif /* lib/syscall-nr.h */
@@ -160,3 +160,71 @@ int inumber(int fd)
 {
     return syscall1(SYS_INUMBER, fd);
 }
+
+pid_t fork(void)
+{
+    return (pid_t)syscall0(SYS_FORK);
+}
+
+void *mmap2(void *addr, unsigned length, int prot, int flags, int fd,
+            unsigned offset)
+{
+    struct mmap_args args = {addr, length, prot, flags, fd, offset};
+
+    return (void *)syscall1(SYS_MMAP2, &args);
+}
+
+bool munmap2(void *addr, unsigned length)
+{
+    return syscall2(SYS_MUNMAP2, addr, length);
+}
+
+bool mprotect(void *addr, unsigned length, int prot)
+{
+    return syscall3(SYS_MPROTECT, addr, length, prot);
+}
+
+bool madvise(void *addr, unsigned length, int advice)
+{
+    return syscall3(SYS_MADVISE, addr, length, advice);
+}
+
+bool msync(void *addr, unsigned length, int flags)
+{
+    return syscall3(SYS_MSYNC, addr, length, flags);
+}
+
+bool setrss(int scope, unsigned soft, unsigned hard)
+{
+    return syscall3(SYS_SETRSS, scope, soft, hard);
+}
+
+int getrss(void)
+{
+    return syscall0(SYS_GETRSS);
+}
+
+bool vmstat(int scope, struct vmstat *st)
+{
+    return syscall2(SYS_VMSTAT, scope, st);
+}
+
+bool wss(struct wss *wss)
+{
+    return syscall1(SYS_WSS, wss);
+}
+
+bool faultstat(struct faultstat *st)
+{
+    return syscall1(SYS_FAULTSTAT, st);
+}
+
+int shm_open(const char *name, int flags, unsigned size)
+{
+    return syscall3(SYS_SHM_OPEN, name, flags, size);
+}
+
+bool shm_unlink(const char *name)
+{
+    return syscall1(SYS_SHM_UNLINK, name);
+}
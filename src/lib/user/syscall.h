@@ -12,6 +12,141 @@ typedef int pid_t;
 typedef int mapid_t;
 #define MAP_FAILED ((mapid_t)-1)
 
+/* Protection and flags for mmap2().  PROT_READ is required: x86
+   pages can't be made inaccessible or write-only.  MAP_SHARED
+   MAP_ANONYMOUS memory is shared with children forked later.
+   Shared memory segments from shm_open() must be MAP_SHARED.
+   Pages of a shared file mapping wholly past the end of the file
+   keep what is written to them, but privately, as with
+   MAP_PRIVATE; the file does not grow. */
+#define PROT_READ 0x1     /* Pages may be read. */
+#define PROT_WRITE 0x2    /* Pages may be written. */
+#define PROT_EXEC 0x4     /* Pages may be executed (implied by read). */
+#define MAP_SHARED 0x01   /* Writes go to the file or segment, seen by all. */
+#define MAP_PRIVATE 0x02  /* Writes stay private to the process. */
+#define MAP_ANONYMOUS 0x20 /* Zero-filled memory, not a file. */
+
+/* Advice for madvise().  The first three describe how a range
+   will be accessed from now on and stay set; the others act once
+   on the pages mapped when they are given.  Ranges must lie in
+   areas mapped with mmap() or mmap2(). */
+#define MADV_NORMAL 0     /* No particular access pattern. */
+#define MADV_RANDOM 1     /* Read only the faulting page. */
+#define MADV_SEQUENTIAL 2 /* Read ahead, drop pages behind. */
+#define MADV_WILLNEED 3   /* Read the pages in now. */
+#define MADV_DONTNEED 4   /* Discard the pages' contents now. */
+#define MADV_FREE 8       /* Contents may be discarded unless rewritten. */
+
+/* Flags for msync().  MS_ASYNC returns at once: dirty pages of a
+   shared mapping are written back when they are evicted or
+   unmapped anyway.  MS_INVALIDATE writes them back too. */
+#define MS_ASYNC 0x1      /* Leave writeback to the kernel. */
+#define MS_INVALIDATE 0x2 /* Read the pages from the file again. */
+#define MS_SYNC 0x4       /* Write dirty pages back before returning. */
+
+/* Scopes for setrss().  Limits are in pages, 0 for none.  A
+   process at a hard limit replaces its own pages instead of
+   growing; one over a soft limit does so when memory is short.
+   Limits and groups pass to children through fork() and exec(). */
+#define RSS_PROCESS 0     /* Set the caller's own limits. */
+#define RSS_GROUP 1       /* Start a group inside the caller's and join it. */
+
+/* Virtual memory statistics read by vmstat(), for the calling
+   process (VMSTAT_PROCESS) or the whole system (VMSTAT_SYSTEM).
+   The clock and swap slot counts are always system-wide.  Faults
+   and evictions are indexed by page type: anonymous zero-fill,
+   private file, shared file mapping, swapped out, shared memory. */
+#define VMSTAT_PROCESS 0
+#define VMSTAT_SYSTEM 1
+#define VMSTAT_TYPES 5
+
+struct vmstat
+{
+    long long faults;           /* Page faults on user addresses. */
+    long long minor_faults;     /* Resolved without I/O. */
+    long long major_faults;     /* Read a file or swap. */
+    long long stack_faults;     /* Grew the stack. */
+    long long type_faults[VMSTAT_TYPES];  /* Resolved, by page type. */
+    long long evictions[VMSTAT_TYPES];    /* Pages evicted, by type. */
+    long long writebacks;       /* Dirty pages written to file or swap. */
+    long long swap_ins;         /* Pages read back from swap. */
+    long long swap_outs;        /* Pages written to swap. */
+    long long clock_turns;      /* Turns of the eviction clock hand. */
+    int resident;               /* Resident pages, or frames in use. */
+    int swap_used;              /* Swap slots in use. */
+    int swap_slots;             /* Swap slots in all. */
+};
+
+/* Working set estimate read by wss(): the calling process's
+   resident pages by how long they have gone unused, in scans of
+   the idle page tracker, which runs every period milliseconds.
+   idle[0] counts pages used since the last scan and idle[i], for
+   i > 0, pages unused for 2**(i-1) to 2**i - 1 scans, so the pages
+   used within the last 2**i scans, a working set estimate over
+   that window, are idle[0] through idle[i].  Pages that only map
+   the shared zero page are not counted, as in getrss(). */
+#define WSS_BUCKETS 9
+
+struct wss
+{
+    int period;                 /* Milliseconds between scans. */
+    int scans;                  /* Scans so far. */
+    int resident;               /* Resident pages. */
+    int idle[WSS_BUCKETS];      /* Resident pages by scans unused. */
+};
+
+/* Page fault latency statistics read by faultstat(), system-wide.
+   Each resolved fault is timed in cycles and counted in hist by
+   page type, in the order of struct vmstat, and by log2 of its
+   cycles: bucket i holds faults that took 2**i to 2**(i+1) - 1.
+   If the kernel was started with -fault-trace=N, the N slowest
+   faults are kept in trace, slowest first, with their time split
+   into the phases below. */
+#define FAULT_LOOKUP 0    /* Finding the page, growing the stack. */
+#define FAULT_FRAME 1     /* Getting a frame, waiting for its lock. */
+#define FAULT_EVICT 2     /* Evicting another page for the frame. */
+#define FAULT_IO 3        /* Reading or zeroing the page. */
+#define FAULT_MAP 4       /* Mapping it, copying it if copy-on-write. */
+#define FAULT_PHASES 5
+#define FAULT_BUCKETS 40
+#define FAULT_TRACE_MAX 16
+
+struct fault_record
+{
+    void *addr;                 /* Page that faulted. */
+    int type;                   /* Its page type. */
+    int tid;                    /* Thread that faulted. */
+    long long cycles;           /* Time to resolve the fault. */
+    long long phase_cycles[FAULT_PHASES];   /* The same, by phase. */
+};
+
+struct faultstat
+{
+    long long hist[VMSTAT_TYPES][FAULT_BUCKETS];
+    int trace_cnt;              /* Faults in trace. */
+    struct fault_record trace[FAULT_TRACE_MAX];
+};
+
+/* Flags for shm_open(), which opens a shared memory segment by
+   name and returns a descriptor for mmap2().  Segments live in
+   memory and swap, in a namespace apart from the file system, and
+   last until unlinked and no longer open or mapped.  filesize()
+   returns a segment's size; read() and write() fail on it. */
+#define SHM_CREAT 0x1     /* Create the segment, SIZE bytes, if missing. */
+#define SHM_EXCL 0x2      /* With SHM_CREAT, fail if it exists. */
+
+/* Arguments of mmap2(), passed by address because there are more
+   than the system call stub takes. */
+struct mmap_args
+{
+    void *addr;        /* Where to map, or NULL to let the kernel choose. */
+    unsigned length;   /* Bytes to map, rounded up to whole pages. */
+    int prot;          /* PROT_* bits. */
+    int flags;         /* MAP_* bits. */
+    int fd;            /* File to map, unless MAP_ANONYMOUS. */
+    unsigned offset;   /* Page-aligned offset in the file. */
+};
+
 /* Maximum characters in a filename written by readdir(). */
 #define READDIR_MAX_LEN 14
 
@@ -45,4 +180,20 @@ bool readdir(int fd, char name[READDIR_MAX_LEN + 1]);
 bool isdir(int fd);
 int inumber(int fd);
 
+/* Extensions. */
+pid_t fork(void);
+void *mmap2(void *addr, unsigned length, int prot, int flags, int fd,
+            unsigned offset);
+bool munmap2(void *addr, unsigned length);
+bool mprotect(void *addr, unsigned length, int prot);
+bool madvise(void *addr, unsigned length, int advice);
+bool msync(void *addr, unsigned length, int flags);
+bool setrss(int scope, unsigned soft, unsigned hard);
+int getrss(void);
+bool vmstat(int scope, struct vmstat *);
+bool wss(struct wss *);
+bool faultstat(struct faultstat *);
+int shm_open(const char *name, int flags, unsigned size);
+bool shm_unlink(const char *name);
+
 #endif /* lib/user/syscall.h */
@@ -0,0 +1,46 @@
+/* Checks that its initialized data, read-only data and bss hold
+   what the executable says, then writes to all of them.  Run more
+   than once, each run must still see the original contents.
+   Exits with status 0x42 if everything matched, otherwise with
+   the number of the check that failed. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+
+#define WORD_CNT 1024           /* Words per page. */
+#define DATA_CNT (3 * WORD_CNT)
+
+static int data[DATA_CNT] =
+  {
+    [0] = 1, [WORD_CNT - 1] = 2, [WORD_CNT] = 3,
+    [2 * WORD_CNT + 17] = 4, [DATA_CNT - 1] = 5,
+  };
+static const int rodata[DATA_CNT] =
+  {
+    [0] = 6, [WORD_CNT + 1] = 7, [DATA_CNT - 1] = 8,
+  };
+static int bss[DATA_CNT];
+
+int
+main (void)
+{
+  int i;
+
+  test_name = "child-eager";
+  quiet = true;
+
+  if (data[0] != 1 || data[WORD_CNT - 1] != 2 || data[WORD_CNT] != 3
+      || data[2 * WORD_CNT + 17] != 4 || data[DATA_CNT - 1] != 5
+      || data[WORD_CNT + 1] != 0)
+    return 1;
+  if (rodata[0] != 6 || rodata[WORD_CNT + 1] != 7
+      || rodata[DATA_CNT - 1] != 8 || rodata[1] != 0)
+    return 2;
+  for (i = 0; i < DATA_CNT; i++)
+    if (bss[i] != 0)
+      return 3;
+
+  for (i = 0; i < DATA_CNT; i++)
+    data[i] = bss[i] = -1;
+  return 0x42;
+}
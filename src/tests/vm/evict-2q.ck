@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(evict-2q) begin
+(evict-2q) parent kept its data
+(evict-2q) child 0 kept its data
+(evict-2q) child 1 kept its data
+(evict-2q) end
+EOF
+pass;
@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(evict-clock) begin
+(evict-clock) parent kept its data
+(evict-clock) child 0 kept its data
+(evict-clock) child 1 kept its data
+(evict-clock) end
+EOF
+pass;
@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(evict-clock2) begin
+(evict-clock2) parent kept its data
+(evict-clock2) child 0 kept its data
+(evict-clock2) child 1 kept its data
+(evict-clock2) end
+EOF
+pass;
@@ -0,0 +1,96 @@
+/* Runs three processes that each keep rewriting a few hot pages
+   while they stream through anonymous and shared file pages,
+   together more than the user pool holds, and check on every
+   pass that all of them kept their data.  Each process finally
+   checks that its file holds what it last wrote.  Built once per
+   page replacement policy and run under the matching -evict=. */
+
+#include <stdio.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE 4096
+#define HOT_CNT 16
+#define COLD_CNT 64
+#define FILE_CNT 32
+#define PASS_CNT 4
+#define CHILD_CNT 2
+
+/* Runs process ID's passes.  Returns 0 if it kept its data,
+   otherwise the step that found it lost. */
+static int
+run (int id)
+{
+  char name[16];
+  char *hot, *cold, *file;
+  char hot_cnt[HOT_CNT];
+  int fd, pass, i;
+
+  snprintf (name, sizeof name, "data%d", id);
+  if (!create (name, FILE_CNT * PAGE) || (fd = open (name)) < 2)
+    return 1;
+  hot = mmap2 (NULL, HOT_CNT * PAGE, PROT_READ | PROT_WRITE,
+               MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  cold = mmap2 (NULL, COLD_CNT * PAGE, PROT_READ | PROT_WRITE,
+                MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  file = mmap2 (NULL, FILE_CNT * PAGE, PROT_READ | PROT_WRITE,
+                MAP_SHARED, fd, 0);
+  if (hot == NULL || cold == NULL || file == NULL)
+    return 2;
+
+  for (i = 0; i < HOT_CNT; i++)
+    hot[i * PAGE] = hot_cnt[i] = 0;
+  for (pass = 0; pass < PASS_CNT; pass++)
+    {
+      for (i = 0; i < COLD_CNT; i++)
+        {
+          int h = i % HOT_CNT;
+
+          if (pass > 0 && cold[i * PAGE] != (char) (id + pass - 1 + i))
+            return 3;
+          cold[i * PAGE] = id + pass + i;
+          if (hot[h * PAGE] != hot_cnt[h])
+            return 4;
+          hot[h * PAGE] = ++hot_cnt[h];
+        }
+      for (i = 0; i < FILE_CNT; i++)
+        {
+          if (pass > 0 && file[i * PAGE] != (char) (id - pass + 1 - i))
+            return 5;
+          file[i * PAGE] = id - pass - i;
+        }
+    }
+
+  if (!munmap2 (file, FILE_CNT * PAGE))
+    return 6;
+  for (i = 0; i < FILE_CNT; i++)
+    {
+      char c;
+
+      seek (fd, i * PAGE);
+      if (read (fd, &c, 1) != 1 || c != (char) (id - PASS_CNT + 1 - i))
+        return 7;
+    }
+  close (fd);
+  return 0;
+}
+
+void
+test_main (void)
+{
+  pid_t children[CHILD_CNT];
+  int i;
+
+  for (i = 0; i < CHILD_CNT; i++)
+    {
+      children[i] = fork ();
+      if (children[i] == 0)
+        exit (run (i + 1));
+      if (children[i] == PID_ERROR)
+        fail ("fork");
+    }
+  CHECK (run (0) == 0, "parent kept its data");
+  for (i = 0; i < CHILD_CNT; i++)
+    CHECK (wait (children[i]) == 0, "child %d kept its data", i);
+}
@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(evict-wsclock) begin
+(evict-wsclock) parent kept its data
+(evict-wsclock) child 0 kept its data
+(evict-wsclock) child 1 kept its data
+(evict-wsclock) end
+EOF
+pass;
@@ -0,0 +1,33 @@
+/* Runs child-eager, whose code and small data segment are mapped
+   when it is loaded, once at a time and then several at once, so
+   that later runs share the code pages of earlier ones.  Every run
+   must find its data as the executable has it, not as an earlier
+   run left it. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define CHILD_CNT 4
+
+void
+test_main (void)
+{
+  pid_t children[CHILD_CNT];
+  int i;
+
+  for (i = 0; i < CHILD_CNT; i++)
+    {
+      CHECK ((children[0] = exec ("child-eager")) != -1,
+             "exec \"child-eager\" %d", i);
+      CHECK (wait (children[0]) == 0x42, "wait for child-eager %d", i);
+    }
+
+  for (i = 0; i < CHILD_CNT; i++)
+    if ((children[i] = exec ("child-eager")) == -1)
+      fail ("exec \"child-eager\" failed");
+  for (i = 0; i < CHILD_CNT; i++)
+    if (wait (children[i]) != 0x42)
+      fail ("parallel child-eager %d saw bad data", i);
+  msg ("parallel children saw their data");
+}
@@ -0,0 +1,18 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(exec-eager) begin
+(exec-eager) exec "child-eager" 0
+(exec-eager) wait for child-eager 0
+(exec-eager) exec "child-eager" 1
+(exec-eager) wait for child-eager 1
+(exec-eager) exec "child-eager" 2
+(exec-eager) wait for child-eager 2
+(exec-eager) exec "child-eager" 3
+(exec-eager) wait for child-eager 3
+(exec-eager) parallel children saw their data
+(exec-eager) end
+EOF
+pass;
@@ -0,0 +1,93 @@
+/* Runs rounds of children that each share a buffer copy-on-write
+   with the parent, write half of it, and fill more private pages
+   than one exit batch holds, enough across the children that some
+   go to swap, then exit without unmapping anything.  The parent's
+   buffer must stay intact, and the frames and swap slots in use
+   after the last round must not exceed those after the first by
+   more than the parent's own pages moving between memory and
+   swap. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE 4096
+#define SHARED_CNT 16
+#define PRIVATE_CNT 96
+#define CHILD_CNT 2
+#define ROUND_CNT 5
+
+/* Frames or slots that may move between rounds without a leak. */
+#define SLACK 16
+
+static char shared[SHARED_CNT * PAGE];
+
+static int
+child (int id)
+{
+  char *p;
+  int i;
+
+  p = mmap2 (NULL, PRIVATE_CNT * PAGE, PROT_READ | PROT_WRITE,
+             MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (p == NULL)
+    return 1;
+  for (i = 0; i < PRIVATE_CNT; i++)
+    p[i * PAGE] = id + i;
+  for (i = 0; i < SHARED_CNT; i++)
+    {
+      if (shared[i * PAGE] != (char) i)
+        return 2;
+      if (i % 2 == id % 2)
+        shared[i * PAGE] = -1;
+    }
+  for (i = 0; i < PRIVATE_CNT; i++)
+    if (p[i * PAGE] != (char) (id + i))
+      return 3;
+  return 0;
+}
+
+/* Returns the frames and swap slots in use. */
+static int
+in_use (void)
+{
+  struct vmstat st;
+
+  if (!vmstat (VMSTAT_SYSTEM, &st))
+    fail ("vmstat failed");
+  return st.resident + st.swap_used;
+}
+
+void
+test_main (void)
+{
+  pid_t children[CHILD_CNT];
+  int first = 0;
+  int round, i;
+
+  for (i = 0; i < SHARED_CNT; i++)
+    shared[i * PAGE] = i;
+
+  for (round = 0; round < ROUND_CNT; round++)
+    {
+      for (i = 0; i < CHILD_CNT; i++)
+        {
+          children[i] = fork ();
+          if (children[i] == 0)
+            exit (child (i));
+          if (children[i] == PID_ERROR)
+            fail ("fork");
+        }
+      for (i = 0; i < CHILD_CNT; i++)
+        if (wait (children[i]) != 0)
+          fail ("child %d of round %d lost its data", i, round);
+      for (i = 0; i < SHARED_CNT; i++)
+        if (shared[i * PAGE] != (char) i)
+          fail ("parent page %d changed in round %d", i, round);
+      if (round == 0)
+        first = in_use ();
+    }
+  msg ("children kept their data");
+  msg ("parent kept its data");
+  CHECK (in_use () <= first + SLACK, "exited children left no frames or slots");
+}
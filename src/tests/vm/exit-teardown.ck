@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(exit-teardown) begin
+(exit-teardown) children kept their data
+(exit-teardown) parent kept its data
+(exit-teardown) exited children left no frames or slots
+(exit-teardown) end
+EOF
+pass;
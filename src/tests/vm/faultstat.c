@@ -0,0 +1,49 @@
+/* Touches 32 pages of anonymous memory and checks the page fault
+   latency histogram and the trace of the slowest faults, which
+   the kernel keeps 4 of. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE 4096
+#define PAGE_CNT 32
+
+static struct faultstat before, after;
+
+void
+test_main (void)
+{
+  long long faults = 0;
+  char *p;
+  int i, j;
+
+  CHECK (faultstat (&before), "faultstat");
+  p = mmap2 (NULL, PAGE_CNT * PAGE, PROT_READ | PROT_WRITE,
+             MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (p == NULL)
+    fail ("mmap2 failed");
+  for (i = 0; i < PAGE_CNT; i++)
+    p[i * PAGE] = i;
+  CHECK (faultstat (&after), "faultstat again");
+
+  for (i = 0; i < FAULT_BUCKETS; i++)
+    faults += after.hist[0][i] - before.hist[0][i];
+  CHECK (faults >= PAGE_CNT, "zero page faults timed");
+
+  CHECK (after.trace_cnt == 4, "4 faults traced");
+  for (i = 0; i < after.trace_cnt; i++)
+    {
+      const struct fault_record *r = &after.trace[i];
+      long long sum = 0;
+
+      for (j = 0; j < FAULT_PHASES; j++)
+        sum += r->phase_cycles[j];
+      if (sum != r->cycles)
+        fail ("phases of fault %d add up to %lld, not %lld",
+              i, sum, r->cycles);
+      if (i > 0 && r->cycles > after.trace[i - 1].cycles)
+        fail ("fault %d slower than fault %d", i, i - 1);
+    }
+  msg ("trace consistent");
+}
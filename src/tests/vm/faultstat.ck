@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(faultstat) begin
+(faultstat) faultstat
+(faultstat) faultstat again
+(faultstat) zero page faults timed
+(faultstat) 4 faults traced
+(faultstat) trace consistent
+(faultstat) end
+EOF
+pass;
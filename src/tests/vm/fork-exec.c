@@ -0,0 +1,30 @@
+/* Forks a child that runs child-linear with exec() and passes
+   its exit status back through its own exit status. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void)
+{
+  pid_t pid;
+  int status;
+
+  pid = fork ();
+  if (pid == 0)
+    {
+      pid_t child;
+
+      CHECK ((child = exec ("child-linear")) != -1,
+             "exec \"child-linear\"");
+      exit (wait (child));
+    }
+  if (pid == PID_ERROR)
+    fail ("fork");
+
+  /* Stay silent until the child is done, so that the output
+     order does not depend on scheduling. */
+  status = wait (pid);
+  CHECK (status == 0x42, "wait for forked child");
+}
@@ -0,0 +1,11 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(fork-exec) begin
+(fork-exec) exec "child-linear"
+(fork-exec) wait for forked child
+(fork-exec) end
+EOF
+pass;
@@ -0,0 +1,44 @@
+/* Maps a file and writes to it, then forks.  The child must see
+   the parent's write through the inherited mapping, and the
+   parent must see the child's write once the child has exited,
+   because file mappings stay shared across fork(). */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/vm/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void)
+{
+  char *actual = (char *) 0x10000000;
+  int handle;
+  mapid_t map;
+  pid_t pid;
+  int status;
+
+  CHECK ((handle = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  CHECK ((map = mmap (handle, actual)) != MAP_FAILED, "mmap \"sample.txt\"");
+  actual[0] = 'X';
+
+  pid = fork ();
+  if (pid == 0)
+    {
+      if (actual[0] != 'X')
+        fail ("child does not see parent's write");
+      if (memcmp (actual + 1, sample + 1, strlen (sample) - 1))
+        fail ("child read bad data from mapping");
+      actual[1] = 'Y';
+      exit (0x42);
+    }
+  if (pid == PID_ERROR)
+    fail ("fork");
+
+  status = wait (pid);
+  CHECK (status == 0x42, "wait for child");
+  CHECK (actual[1] == 'Y', "check child's write");
+
+  munmap (map);
+  close (handle);
+}
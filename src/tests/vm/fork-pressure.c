@@ -0,0 +1,60 @@
+/* Fills a 2 MB buffer with random data, then forks children that
+   each decrypt their copy back to zeros while the parent's copy
+   must stay intact.  With several copies of the buffer alive,
+   this exercises copy-on-write frames and swap slots shared by
+   fork() under memory pressure. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/arc4.h"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define SIZE (2 * 1024 * 1024)
+#define CHILD_CNT 3
+
+static char buf[SIZE];
+
+/* Decrypts BUF, which must then be all zeros. */
+static void
+decrypt_and_check (void) 
+{
+  struct arc4 arc4;
+  size_t i;
+
+  arc4_init (&arc4, "foobar", 6);
+  arc4_crypt (&arc4, buf, SIZE);
+  for (i = 0; i < SIZE; i++)
+    if (buf[i] != '\0')
+      fail ("byte %zu != 0", i);
+}
+
+void
+test_main (void)
+{
+  struct arc4 arc4;
+  pid_t children[CHILD_CNT];
+  int i;
+
+  arc4_init (&arc4, "foobar", 6);
+  arc4_crypt (&arc4, buf, SIZE);
+
+  for (i = 0; i < CHILD_CNT; i++) 
+    {
+      msg ("fork child %d", i);
+      children[i] = fork ();
+      if (children[i] == 0)
+        {
+          decrypt_and_check ();
+          exit (i);
+        }
+      if (children[i] == PID_ERROR)
+        fail ("fork child %d", i);
+    }
+
+  for (i = 0; i < CHILD_CNT; i++) 
+    CHECK (wait (children[i]) == i, "wait for child %d", i);
+
+  msg ("check parent's copy");
+  decrypt_and_check ();
+}
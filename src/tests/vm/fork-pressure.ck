@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(fork-pressure) begin
+(fork-pressure) fork child 0
+(fork-pressure) fork child 1
+(fork-pressure) fork child 2
+(fork-pressure) wait for child 0
+(fork-pressure) wait for child 1
+(fork-pressure) wait for child 2
+(fork-pressure) check parent's copy
+(fork-pressure) end
+EOF
+pass;
@@ -0,0 +1,65 @@
+/* Fills 32 pages of anonymous memory with the same contents and
+   spins while the kernel, run with same-page merging on, maps them
+   onto one frame.  Then writes each odd page and checks that the
+   write went to that page alone, and does the same for the even
+   pages, the last of which is left alone on the merged frame and
+   writes it in place.  The check script reads the
+   merge count that the kernel prints at shutdown. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE 4096
+#define PAGE_CNT 32
+
+/* Iterations of the busy loop that gives the merging thread time
+   for two passes over the frames. */
+#define SPIN 100000000
+
+/* Checks that byte 0 of each odd page holds ODD and of each even
+   page EVEN, and that every other byte kept the fill pattern. */
+static void
+check_pages (const char *p, char odd, char even)
+{
+  size_t i, j;
+
+  for (i = 0; i < PAGE_CNT; i++)
+    for (j = 0; j < PAGE; j++)
+      {
+        char expected = j != 0 ? (char) (j % 251) : i % 2 ? odd : even;
+        if (p[i * PAGE + j] != expected)
+          fail ("byte %zu of page %zu is %d, expected %d",
+                j, i, p[i * PAGE + j], expected);
+      }
+}
+
+void
+test_main (void)
+{
+  volatile int spin;
+  char *p;
+  size_t i, j;
+
+  p = mmap2 (NULL, PAGE_CNT * PAGE, PROT_READ | PROT_WRITE,
+             MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  CHECK (p != NULL, "mmap2 %d pages", PAGE_CNT);
+  for (i = 0; i < PAGE_CNT; i++)
+    for (j = 0; j < PAGE; j++)
+      p[i * PAGE + j] = j % 251;
+  msg ("fill pages");
+
+  for (spin = 0; spin < SPIN; spin++)
+    continue;
+
+  for (i = 1; i < PAGE_CNT; i += 2)
+    p[i * PAGE] = 'x';
+  check_pages (p, 'x', 0);
+  msg ("write odd pages");
+
+  for (i = 0; i < PAGE_CNT; i += 2)
+    p[i * PAGE] = 'y';
+  check_pages (p, 'x', 'y');
+  msg ("write even pages");
+}
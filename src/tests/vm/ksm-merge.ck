@@ -0,0 +1,20 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(ksm-merge) begin
+(ksm-merge) mmap2 32 pages
+(ksm-merge) fill pages
+(ksm-merge) write odd pages
+(ksm-merge) write even pages
+(ksm-merge) end
+EOF
+
+# Identical pages that are never merged would mean the merging
+# thread is not running.
+my ($merged) = map (/^Frame: \d+ scanned for merging, (\d+) pages merged/ ? $1 : (),
+		    read_text_file ("$test.output"));
+fail "No merge count in output\n" if !defined $merged;
+fail "No pages merged\n" if $merged == 0;
+pass;
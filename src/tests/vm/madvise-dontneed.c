@@ -0,0 +1,51 @@
+/* Checks that MADV_DONTNEED discards written pages, so that
+   anonymous memory reads as zeros and a private file mapping
+   reads the file again, and that pages written after MADV_FREE
+   keep their data. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/vm/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE 4096
+#define PAGE_CNT 4
+
+void
+test_main (void)
+{
+  size_t len = strlen (sample);
+  char *anon, *p;
+  int handle;
+  size_t i;
+
+  CHECK ((anon = mmap2 (NULL, PAGE_CNT * PAGE, PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS, -1, 0)) != NULL,
+         "mmap2 anonymous");
+  memset (anon, 'a', PAGE_CNT * PAGE);
+  CHECK (madvise (anon + PAGE, 2 * PAGE, MADV_DONTNEED), "madvise dontneed");
+  for (i = PAGE; i < 3 * PAGE; i++)
+    if (anon[i] != 0)
+      fail ("byte %zu not discarded", i);
+  if (anon[0] != 'a' || anon[3 * PAGE] != 'a')
+    fail ("pages outside the range discarded");
+
+  CHECK (madvise (anon, PAGE_CNT * PAGE, MADV_FREE), "madvise free");
+  anon[0] = 'b';
+  anon[PAGE_CNT * PAGE - 1] = 'c';
+  if (anon[0] != 'b' || anon[PAGE_CNT * PAGE - 1] != 'c')
+    fail ("write after MADV_FREE lost");
+
+  CHECK ((handle = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  CHECK ((p = mmap2 (NULL, len, PROT_READ | PROT_WRITE, MAP_PRIVATE,
+                     handle, 0)) != NULL, "mmap2 \"sample.txt\"");
+  memset (p, 'x', len);
+  CHECK (madvise (p, len, MADV_DONTNEED), "madvise dontneed on file");
+  if (memcmp (p, sample, len))
+    fail ("file mapping not read again");
+  CHECK (!madvise (p, len, MADV_FREE), "madvise free on file fails");
+  CHECK (!madvise (anon + PAGE_CNT * PAGE, PAGE, MADV_WILLNEED),
+         "madvise past the mapping fails");
+  close (handle);
+}
@@ -0,0 +1,17 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(madvise-dontneed) begin
+(madvise-dontneed) mmap2 anonymous
+(madvise-dontneed) madvise dontneed
+(madvise-dontneed) madvise free
+(madvise-dontneed) open "sample.txt"
+(madvise-dontneed) mmap2 "sample.txt"
+(madvise-dontneed) madvise dontneed on file
+(madvise-dontneed) madvise free on file fails
+(madvise-dontneed) madvise past the mapping fails
+(madvise-dontneed) end
+EOF
+pass;
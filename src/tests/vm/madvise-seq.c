@@ -0,0 +1,41 @@
+/* Reads a 128-page file mapping front to back after advising
+   MADV_SEQUENTIAL.  The kernel runs with fault-around off, so
+   without the advice every page would fault; with it, each fault
+   reads a window of pages ahead.  The check script counts the
+   page faults. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE 4096
+#define PAGE_CNT 128
+
+static unsigned buf[PAGE / sizeof (unsigned)];
+
+void
+test_main (void)
+{
+  unsigned *p;
+  int handle;
+  size_t i;
+
+  CHECK (create ("big", PAGE_CNT * PAGE), "create \"big\"");
+  CHECK ((handle = open ("big")) > 1, "open \"big\"");
+  for (i = 0; i < PAGE_CNT; i++)
+    {
+      buf[0] = i;
+      if (write (handle, buf, PAGE) != PAGE)
+        fail ("write page %zu failed", i);
+    }
+
+  CHECK ((p = mmap2 (NULL, PAGE_CNT * PAGE, PROT_READ, MAP_PRIVATE,
+                     handle, 0)) != NULL, "mmap2 \"big\"");
+  CHECK (madvise (p, PAGE_CNT * PAGE, MADV_SEQUENTIAL), "madvise sequential");
+  for (i = 0; i < PAGE_CNT; i++)
+    if (p[i * PAGE / sizeof *p] != i)
+      fail ("page %zu has bad data", i);
+  msg ("read %d pages", PAGE_CNT);
+  close (handle);
+}
@@ -0,0 +1,22 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(madvise-seq) begin
+(madvise-seq) create "big"
+(madvise-seq) open "big"
+(madvise-seq) mmap2 "big"
+(madvise-seq) madvise sequential
+(madvise-seq) read 128 pages
+(madvise-seq) end
+EOF
+
+# Fault-around is off, so one fault per page would show the advice
+# was ignored.
+my ($faults) = map (/^Exception: (\d+) page faults/ ? $1 : (),
+		     read_text_file ("$test.output"));
+fail "No page fault count in output\n" if !defined $faults;
+fail "$faults page faults, expected fewer than 64\n"
+  if $faults >= 64;
+pass;
@@ -0,0 +1,48 @@
+/* Advises MADV_WILLNEED on a 64-page file mapping and then reads
+   it in random order.  The kernel runs with fault-around off, so
+   each page would fault on first use if it had not been read in
+   by the advice.  The check script counts the page faults. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/arc4.h"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE 4096
+#define PAGE_CNT 64
+
+static unsigned buf[PAGE / sizeof (unsigned)];
+
+void
+test_main (void)
+{
+  struct arc4 arc4;
+  unsigned *p;
+  int handle;
+  size_t i;
+
+  CHECK (create ("big", PAGE_CNT * PAGE), "create \"big\"");
+  CHECK ((handle = open ("big")) > 1, "open \"big\"");
+  for (i = 0; i < PAGE_CNT; i++)
+    {
+      buf[0] = i;
+      if (write (handle, buf, PAGE) != PAGE)
+        fail ("write page %zu failed", i);
+    }
+
+  CHECK ((p = mmap2 (NULL, PAGE_CNT * PAGE, PROT_READ, MAP_PRIVATE,
+                     handle, 0)) != NULL, "mmap2 \"big\"");
+  CHECK (madvise (p, PAGE_CNT * PAGE, MADV_WILLNEED), "madvise willneed");
+  arc4_init (&arc4, "willneed", 8);
+  for (i = 0; i < PAGE_CNT * 4; i++)
+    {
+      unsigned char page;
+      arc4_crypt (&arc4, &page, 1);
+      page %= PAGE_CNT;
+      if (p[page * PAGE / sizeof *p] != page)
+        fail ("page %u has bad data", page);
+    }
+  msg ("read %d pages", PAGE_CNT);
+  close (handle);
+}
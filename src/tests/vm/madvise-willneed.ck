@@ -0,0 +1,22 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(madvise-willneed) begin
+(madvise-willneed) create "big"
+(madvise-willneed) open "big"
+(madvise-willneed) mmap2 "big"
+(madvise-willneed) madvise willneed
+(madvise-willneed) read 64 pages
+(madvise-willneed) end
+EOF
+
+# Fault-around is off, so one fault per page would show the advice
+# was ignored.
+my ($faults) = map (/^Exception: (\d+) page faults/ ? $1 : (),
+		     read_text_file ("$test.output"));
+fail "No page fault count in output\n" if !defined $faults;
+fail "$faults page faults, expected fewer than 32\n"
+  if $faults >= 32;
+pass;
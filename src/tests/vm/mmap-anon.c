@@ -0,0 +1,62 @@
+/* Maps anonymous memory at an address the kernel picks, then
+   checks that it reads as zeros, that mprotect() makes part of
+   it read-only, that munmap2() of nothing fails, and that
+   munmap2() of a page in the middle leaves the pages around it
+   intact.  Children test the
+   accesses that must kill them. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE 4096
+#define PAGE_CNT 8
+
+/* Forks a child that writes to ADDR, which must kill it. */
+static void
+write_must_fail (char *addr, const char *what)
+{
+  pid_t child = fork ();
+  if (child == 0)
+    {
+      *addr = 1;
+      exit (0);
+    }
+  CHECK (wait (child) == -1, "write %s", what);
+}
+
+void
+test_main (void)
+{
+  char *p;
+  size_t i;
+
+  CHECK ((p = mmap2 (NULL, PAGE_CNT * PAGE, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0)) != NULL,
+         "mmap2 anonymous");
+  for (i = 0; i < PAGE_CNT * PAGE; i++)
+    if (p[i] != 0)
+      fail ("byte %zu != 0", i);
+  memset (p, 'a', PAGE_CNT * PAGE);
+
+  CHECK (mprotect (p + 2 * PAGE, 2 * PAGE, PROT_READ), "mprotect read-only");
+  CHECK (p[2 * PAGE] == 'a' && p[4 * PAGE - 1] == 'a', "read-only pages kept data");
+  write_must_fail (p + 3 * PAGE, "read-only page");
+  p[PAGE] = 'b';
+  p[4 * PAGE] = 'c';
+
+  CHECK (mprotect (p + 2 * PAGE, PAGE, PROT_READ | PROT_WRITE), "mprotect writable");
+  p[2 * PAGE] = 'd';
+
+  CHECK (!munmap2 (p + 5 * PAGE, 0), "munmap2 zero length fails");
+  CHECK (munmap2 (p + 5 * PAGE, PAGE), "munmap2 one page");
+  write_must_fail (p + 5 * PAGE, "unmapped page");
+  CHECK (p[4 * PAGE] == 'c' && p[6 * PAGE] == 'a', "neighbours intact");
+
+  CHECK (mmap2 (p + 5 * PAGE, PAGE, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS,
+                -1, 0) == p + 5 * PAGE, "mmap2 into the hole");
+  CHECK (mmap2 (p, PAGE, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0) == NULL,
+         "mmap2 over a mapping fails");
+  CHECK (munmap2 (p, PAGE_CNT * PAGE), "munmap2 everything");
+}
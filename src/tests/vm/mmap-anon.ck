@@ -0,0 +1,21 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(mmap-anon) begin
+(mmap-anon) mmap2 anonymous
+(mmap-anon) mprotect read-only
+(mmap-anon) read-only pages kept data
+(mmap-anon) write read-only page
+(mmap-anon) mprotect writable
+(mmap-anon) munmap2 zero length fails
+(mmap-anon) munmap2 one page
+(mmap-anon) write unmapped page
+(mmap-anon) neighbours intact
+(mmap-anon) mmap2 into the hole
+(mmap-anon) mmap2 over a mapping fails
+(mmap-anon) munmap2 everything
+(mmap-anon) end
+EOF
+pass;
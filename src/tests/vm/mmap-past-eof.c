@@ -0,0 +1,41 @@
+/* Maps a 2-page file shared with 16 pages, writes every page, and
+   streams through more memory than the user pool holds so that
+   the pages past the end of the file are evicted.  What was
+   written to them must survive, and the file must not grow. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE 4096
+#define FILE_CNT 2
+#define MAP_CNT 16
+#define STREAM_CNT 192
+
+void
+test_main (void)
+{
+  char *p, *s;
+  int handle, i;
+
+  CHECK (create ("data", FILE_CNT * PAGE), "create \"data\"");
+  CHECK ((handle = open ("data")) > 1, "open \"data\"");
+  CHECK ((p = mmap2 (NULL, MAP_CNT * PAGE, PROT_READ | PROT_WRITE, MAP_SHARED,
+                     handle, 0)) != NULL, "mmap2 \"data\" past its end");
+  for (i = 0; i < MAP_CNT; i++)
+    p[i * PAGE] = 'a' + i;
+
+  s = mmap2 (NULL, STREAM_CNT * PAGE, PROT_READ | PROT_WRITE,
+             MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (s == NULL)
+    fail ("mmap2 failed");
+  for (i = 0; i < STREAM_CNT; i++)
+    s[i * PAGE] = i;
+
+  for (i = 0; i < MAP_CNT; i++)
+    if (p[i * PAGE] != 'a' + i)
+      fail ("page %d lost its data", i);
+  msg ("pages intact");
+  CHECK (msync (p, MAP_CNT * PAGE, MS_SYNC), "msync");
+  CHECK (filesize (handle) == FILE_CNT * PAGE, "file size unchanged");
+}
@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(mmap-past-eof) begin
+(mmap-past-eof) create "data"
+(mmap-past-eof) open "data"
+(mmap-past-eof) mmap2 "data" past its end
+(mmap-past-eof) pages intact
+(mmap-past-eof) msync
+(mmap-past-eof) file size unchanged
+(mmap-past-eof) end
+EOF
+pass;
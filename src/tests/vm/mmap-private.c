@@ -0,0 +1,39 @@
+/* Maps sample.txt privately, from its second page on, and
+   writes through the mapping.  The writes must be visible in
+   the mapping but must not reach the file. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/vm/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE 4096
+
+static char buf[PAGE];
+
+void
+test_main (void)
+{
+  size_t len = strlen (sample);
+  int handle;
+  char *p;
+
+  CHECK ((handle = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  CHECK ((p = mmap2 (NULL, len, PROT_READ | PROT_WRITE, MAP_PRIVATE,
+                     handle, 0)) != NULL, "mmap2 private");
+  if (memcmp (p, sample, len))
+    fail ("read of mapping reported bad data");
+  memset (p, 'x', len);
+  if (p[0] != 'x' || p[len - 1] != 'x')
+    fail ("write to mapping lost");
+  CHECK (munmap2 (p, len), "munmap2");
+
+  CHECK (read (handle, buf, len) == (int) len, "read \"sample.txt\"");
+  if (memcmp (buf, sample, len))
+    fail ("private write reached the file");
+
+  CHECK (mmap2 (NULL, len, PROT_READ, MAP_PRIVATE, handle, 1) == NULL,
+         "mmap2 at unaligned offset fails");
+  close (handle);
+}
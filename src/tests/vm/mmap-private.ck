@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(mmap-private) begin
+(mmap-private) open "sample.txt"
+(mmap-private) mmap2 private
+(mmap-private) munmap2
+(mmap-private) read "sample.txt"
+(mmap-private) mmap2 at unaligned offset fails
+(mmap-private) end
+EOF
+pass;
@@ -0,0 +1,61 @@
+/* Writes through a shared mapping of a 32-page file and checks
+   that msync(MS_SYNC) makes the writes visible to read() without
+   growing the file, that MS_INVALIDATE makes a write() visible in
+   the mapping, and that bad arguments are rejected. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE 4096
+#define PAGE_CNT 32
+#define FILE_SIZE (PAGE_CNT * PAGE - 100)
+
+static char buf[PAGE];
+
+void
+test_main (void)
+{
+  char *p;
+  int handle;
+  size_t i;
+
+  CHECK (create ("data", FILE_SIZE), "create \"data\"");
+  CHECK ((handle = open ("data")) > 1, "open \"data\"");
+  CHECK ((p = mmap2 (NULL, FILE_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED,
+                     handle, 0)) != NULL, "mmap2 \"data\"");
+
+  /* Leave every fourth page clean, so that the writeback has
+     several runs to coalesce. */
+  for (i = 0; i < PAGE_CNT; i++)
+    if (i % 4 != 3)
+      memset (p + i * PAGE, 'a' + i % 26, i < PAGE_CNT - 1 ? PAGE : PAGE - 100);
+  CHECK (msync (p, FILE_SIZE, MS_SYNC), "msync");
+  CHECK (filesize (handle) == FILE_SIZE, "file size unchanged");
+
+  for (i = 0; i < PAGE_CNT; i++)
+    {
+      size_t size = i < PAGE_CNT - 1 ? PAGE : PAGE - 100;
+      size_t j;
+
+      if (read (handle, buf, size) != (int) size)
+        fail ("read page %zu failed", i);
+      for (j = 0; j < size; j++)
+        if (buf[j] != (i % 4 != 3 ? 'a' + (int) (i % 26) : 0))
+          fail ("byte %zu of page %zu is wrong", j, i);
+    }
+  msg ("file holds the writes");
+
+  seek (handle, 0);
+  CHECK (write (handle, "z", 1) == 1, "write \"z\" to the file");
+  CHECK (msync (p, PAGE, MS_SYNC | MS_INVALIDATE), "msync invalidate");
+  CHECK (p[0] == 'z' && p[1] == 'a', "mapping holds the write");
+
+  CHECK (!msync (p + 1, PAGE, MS_SYNC), "msync unaligned fails");
+  CHECK (!msync (p, PAGE, MS_SYNC | MS_ASYNC), "msync sync and async fails");
+  CHECK (msync (p, FILE_SIZE, MS_ASYNC), "msync async");
+  CHECK (munmap2 (p, FILE_SIZE), "munmap2");
+  CHECK (!msync (p, PAGE, MS_SYNC), "msync unmapped fails");
+  close (handle);
+}
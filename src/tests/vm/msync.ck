@@ -0,0 +1,23 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(msync) begin
+(msync) create "data"
+(msync) open "data"
+(msync) mmap2 "data"
+(msync) msync
+(msync) file size unchanged
+(msync) file holds the writes
+(msync) write "z" to the file
+(msync) msync invalidate
+(msync) mapping holds the write
+(msync) msync unaligned fails
+(msync) msync sync and async fails
+(msync) msync async
+(msync) munmap2
+(msync) msync unmapped fails
+(msync) end
+EOF
+pass;
@@ -0,0 +1,95 @@
+/* Maps, fills and unmaps runs of 1, 32, 33 and 128 pages, the last
+   two more than one batch of single-page TLB invalidations holds.
+   Anonymous memory mapped again at the same address must read as
+   zeros, not as the old contents through a stale TLB entry, and a
+   child that reads a run, unmaps it and reads it again must be
+   killed.  Then unmaps the middle of a run, which must leave the
+   pages on either side intact. */
+
+#include <stddef.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE 4096
+
+static char *
+map (char *p, size_t cnt)
+{
+  return mmap2 (p, cnt * PAGE, PROT_READ | PROT_WRITE,
+                MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+}
+
+/* Stores C + I in page I of the CNT pages at P. */
+static void
+fill (char *p, size_t cnt, int c)
+{
+  size_t i;
+
+  for (i = 0; i < cnt; i++)
+    p[i * PAGE] = c + i;
+}
+
+/* Returns true if page I of the pages at P holds C + I, for each
+   I from FIRST up to LAST. */
+static bool
+holds (const char *p, size_t first, size_t last, int c)
+{
+  size_t i;
+
+  for (i = first; i <= last; i++)
+    if (p[i * PAGE] != (char) (c + i))
+      return false;
+  return true;
+}
+
+static void
+unmap_run (size_t cnt)
+{
+  char *p;
+  size_t i;
+  pid_t child;
+
+  CHECK ((p = map (NULL, cnt)) != NULL, "mmap2 %zu pages", cnt);
+  fill (p, cnt, 1);
+  if (!holds (p, 0, cnt - 1, 1))
+    fail ("%zu pages lost their data", cnt);
+  CHECK (munmap2 (p, cnt * PAGE), "munmap2 %zu pages", cnt);
+  CHECK (map (p, cnt) == p, "mmap2 %zu pages again", cnt);
+  for (i = 0; i < cnt; i++)
+    if (p[i * PAGE] != 0)
+      fail ("page %zu of %zu kept its old data", i, cnt);
+
+  fill (p, cnt, 2);
+  child = fork ();
+  if (child == 0)
+    {
+      if (!holds (p, 0, cnt - 1, 2))
+        exit (1);
+      munmap2 (p, cnt * PAGE);
+      fail ("unmapped memory is readable (%d)", p[(cnt - 1) * PAGE]);
+    }
+  if (child == PID_ERROR)
+    fail ("fork");
+  CHECK (wait (child) == -1, "child killed reading %zu unmapped pages", cnt);
+  CHECK (munmap2 (p, cnt * PAGE), "munmap2 %zu pages again", cnt);
+}
+
+void
+test_main (void)
+{
+  char *p;
+
+  unmap_run (1);
+  unmap_run (32);
+  unmap_run (33);
+  unmap_run (128);
+
+  CHECK ((p = map (NULL, 64)) != NULL, "mmap2 64 pages");
+  fill (p, 64, 3);
+  CHECK (munmap2 (p + 10 * PAGE, 33 * PAGE), "munmap2 middle 33 pages");
+  CHECK (holds (p, 0, 9, 3) && holds (p, 43, 63, 3),
+         "pages around the hole intact");
+  CHECK (map (p + 10 * PAGE, 33) == p + 10 * PAGE, "mmap2 middle again");
+  CHECK (p[20 * PAGE] == 0, "middle reads zeros");
+}
@@ -0,0 +1,34 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(munmap-tlb) begin
+(munmap-tlb) mmap2 1 pages
+(munmap-tlb) munmap2 1 pages
+(munmap-tlb) mmap2 1 pages again
+(munmap-tlb) child killed reading 1 unmapped pages
+(munmap-tlb) munmap2 1 pages again
+(munmap-tlb) mmap2 32 pages
+(munmap-tlb) munmap2 32 pages
+(munmap-tlb) mmap2 32 pages again
+(munmap-tlb) child killed reading 32 unmapped pages
+(munmap-tlb) munmap2 32 pages again
+(munmap-tlb) mmap2 33 pages
+(munmap-tlb) munmap2 33 pages
+(munmap-tlb) mmap2 33 pages again
+(munmap-tlb) child killed reading 33 unmapped pages
+(munmap-tlb) munmap2 33 pages again
+(munmap-tlb) mmap2 128 pages
+(munmap-tlb) munmap2 128 pages
+(munmap-tlb) mmap2 128 pages again
+(munmap-tlb) child killed reading 128 unmapped pages
+(munmap-tlb) munmap2 128 pages again
+(munmap-tlb) mmap2 64 pages
+(munmap-tlb) munmap2 middle 33 pages
+(munmap-tlb) pages around the hole intact
+(munmap-tlb) mmap2 middle again
+(munmap-tlb) middle reads zeros
+(munmap-tlb) end
+EOF
+pass;
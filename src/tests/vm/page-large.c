@@ -0,0 +1,63 @@
+/* Fills 8 MB of zero-fill data, enough to hold a 4 MB aligned
+   region the kernel can back with a 4 MB page when run with
+   -large-pages, then forks a child that rewrites its copy.  The
+   child's writes split the shared large page into 4 kB pages,
+   which must not disturb the parent's data. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define SIZE (8 * 1024 * 1024)
+#define PAGE 4096
+
+static char buf[SIZE];
+
+/* Fails unless every byte of BUF is its index plus SEED,
+   modulo 251. */
+static void
+check (int seed)
+{
+  size_t i;
+
+  for (i = 0; i < SIZE; i++)
+    if (buf[i] != (char) ((i + seed) % 251))
+      fail ("byte %zu is wrong", i);
+}
+
+/* Fills BUF with the pattern check() expects. */
+static void
+fill (int seed)
+{
+  size_t i;
+
+  for (i = 0; i < SIZE; i++)
+    buf[i] = (i + seed) % 251;
+}
+
+void
+test_main (void)
+{
+  pid_t child;
+
+  msg ("fill buffer");
+  fill (0);
+  check (0);
+
+  msg ("fork child");
+  child = fork ();
+  if (child == 0)
+    {
+      check (0);
+      fill (7);
+      check (7);
+      exit (42);
+    }
+  if (child == PID_ERROR)
+    fail ("fork");
+  CHECK (wait (child) == 42, "wait for child");
+
+  msg ("check parent's copy");
+  check (0);
+}
@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(page-large) begin
+(page-large) fill buffer
+(page-large) fork child
+(page-large) wait for child
+(page-large) check parent's copy
+(page-large) end
+EOF
+pass;
@@ -0,0 +1,36 @@
+/* Reads through 4 MB of zeroed data, more than fits in the user
+   pool, then writes one byte in every 64th page and verifies that
+   only those bytes changed. */
+
+#include <string.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define SIZE (4 * 1024 * 1024)
+#define PAGE 4096
+#define STRIDE (64 * PAGE)
+
+static char buf[SIZE];
+
+void
+test_main (void)
+{
+  size_t i;
+
+  msg ("read pass");
+  for (i = 0; i < SIZE; i++)
+    if (buf[i] != 0)
+      fail ("byte %zu != 0", i);
+
+  msg ("sparse write pass");
+  for (i = 0; i < SIZE; i += STRIDE)
+    buf[i + i / STRIDE] = 0x5a;
+
+  msg ("read pass");
+  for (i = 0; i < SIZE; i++)
+    {
+      char expected = i % STRIDE == i / STRIDE ? 0x5a : 0;
+      if (buf[i] != expected)
+        fail ("byte %zu != %d", i, expected);
+    }
+}
@@ -0,0 +1,98 @@
+/* Forks children that each read sample.txt into buffers spread
+   across a 2 MB array, most of whose pages are swapped out or
+   shared copy-on-write with the other processes, then write the
+   buffers to a file of their own and read that back.  The kernel
+   must bring the buffers in before it takes the file system lock
+   and keep them resident until the transfer is done. */
+
+#include <stdio.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/arc4.h"
+#include "tests/lib.h"
+#include "tests/main.h"
+#include "tests/vm/sample.inc"
+
+#define SIZE (2 * 1024 * 1024)
+#define CHILD_CNT 3
+#define BUF_CNT 32
+
+static char buf[SIZE];
+
+/* Returns the offset in BUF of the Ith buffer, which straddles a
+   page boundary. */
+static size_t
+buf_ofs (int i)
+{
+  return i * (SIZE / BUF_CNT) + 4096 - 100;
+}
+
+/* Reads sample.txt into every buffer and writes each buffer to a
+   file named after child ID, then checks both. */
+static void
+child (int id)
+{
+  char name[16];
+  size_t len = sizeof sample - 1;
+  int fd, i;
+
+  quiet = true;
+  fd = open ("sample.txt");
+  if (fd < 0)
+    fail ("open \"sample.txt\"");
+  for (i = 0; i < BUF_CNT; i++)
+    {
+      seek (fd, 0);
+      if (read (fd, buf + buf_ofs (i), len) != (int) len)
+        fail ("read into buffer %d", i);
+    }
+  close (fd);
+
+  snprintf (name, sizeof name, "pin-%d", id);
+  if (!create (name, 0))
+    fail ("create \"%s\"", name);
+  fd = open (name);
+  if (fd < 0)
+    fail ("open \"%s\"", name);
+  for (i = 0; i < BUF_CNT; i++)
+    if (write (fd, buf + buf_ofs (i), len) != (int) len)
+      fail ("write from buffer %d", i);
+
+  seek (fd, 0);
+  for (i = BUF_CNT - 1; i >= 0; i--)
+    {
+      memset (buf + buf_ofs (i), 0, len);
+      if (read (fd, buf + buf_ofs (i), len) != (int) len)
+        fail ("read back into buffer %d", i);
+      if (memcmp (buf + buf_ofs (i), sample, len))
+        fail ("buffer %d differs from sample.txt", i);
+    }
+  close (fd);
+}
+
+void
+test_main (void)
+{
+  struct arc4 arc4;
+  pid_t children[CHILD_CNT];
+  int i;
+
+  arc4_init (&arc4, "foobar", 6);
+  arc4_crypt (&arc4, buf, SIZE);
+
+  for (i = 0; i < CHILD_CNT; i++)
+    {
+      msg ("fork child %d", i);
+      children[i] = fork ();
+      if (children[i] == 0)
+        {
+          child (i);
+          exit (i);
+        }
+      if (children[i] == PID_ERROR)
+        fail ("fork child %d", i);
+    }
+
+  for (i = 0; i < CHILD_CNT; i++)
+    CHECK (wait (children[i]) == i, "wait for child %d", i);
+}
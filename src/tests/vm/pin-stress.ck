@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(pin-stress) begin
+(pin-stress) fork child 0
+(pin-stress) fork child 1
+(pin-stress) fork child 2
+(pin-stress) wait for child 0
+(pin-stress) wait for child 1
+(pin-stress) wait for child 2
+(pin-stress) end
+EOF
+pass;
@@ -0,0 +1,34 @@
+/* Writes a 64-page stack object from its top down, with the
+   kernel mapping 4 stack pages per growth fault, and checks that
+   growth took about a quarter as many faults as pages. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE 4096
+#define PAGE_CNT 64
+
+static void
+grow (void)
+{
+  char stack_obj[PAGE_CNT * PAGE];
+  struct vmstat before, after;
+  int i;
+
+  CHECK (vmstat (VMSTAT_PROCESS, &before), "vmstat before");
+  for (i = PAGE_CNT - 1; i >= 0; i--)
+    ((volatile char *) stack_obj)[i * PAGE] = i;
+  for (i = 0; i < PAGE_CNT; i++)
+    if (stack_obj[i * PAGE] != i)
+      fail ("stack page %d lost its data", i);
+  CHECK (vmstat (VMSTAT_PROCESS, &after), "vmstat after");
+  CHECK (after.stack_faults - before.stack_faults <= PAGE_CNT / 4 + 4,
+         "stack grew in windows");
+}
+
+void
+test_main (void)
+{
+  grow ();
+}
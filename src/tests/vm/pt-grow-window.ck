@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(pt-grow-window) begin
+(pt-grow-window) vmstat before
+(pt-grow-window) vmstat after
+(pt-grow-window) stack grew in windows
+(pt-grow-window) end
+EOF
+pass;
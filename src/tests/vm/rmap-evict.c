@@ -0,0 +1,122 @@
+/* Shares private pages copy-on-write and a shared anonymous
+   region among a parent and three children, then streams another
+   child through more memory than the user pool holds, so that
+   frames mapped by all four processes are evicted and must be
+   unmapped from each of them.  Each process then reads the pages
+   back, the children write some of them, and every process must
+   see its own data and the children's shared writes. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE 4096
+#define COW_CNT 64
+#define SHARED_CNT 16
+#define STREAM_CNT 192
+#define CHILD_CNT 3
+
+static volatile char *cow, *shared;
+
+/* Set by the parent once the streaming child is done. */
+static volatile int *go;
+
+/* Checks the pages as child ID must see them, with the shared
+   ones written by other children or not yet, writes its own, and
+   checks them again.  Returns 0 if all matched. */
+static int
+reader (int id)
+{
+  int i;
+
+  while (!*go)
+    continue;
+  for (i = 0; i < COW_CNT; i++)
+    if (cow[i * PAGE] != (char) i)
+      return 1;
+  for (i = 0; i < SHARED_CNT; i++)
+    if (shared[i * PAGE] != (char) (i + 100)
+        && shared[i * PAGE] != -(i % CHILD_CNT) - 1)
+      return 2;
+  for (i = id; i < COW_CNT; i += CHILD_CNT)
+    cow[i * PAGE] = -id - 1;
+  for (i = id; i < SHARED_CNT; i += CHILD_CNT)
+    shared[i * PAGE] = -id - 1;
+  for (i = 0; i < COW_CNT; i++)
+    if (cow[i * PAGE] != (i % CHILD_CNT == id ? -id - 1 : i))
+      return 3;
+  return 0;
+}
+
+static int
+stream (void)
+{
+  char *s;
+  int pass, i;
+
+  s = mmap2 (NULL, STREAM_CNT * PAGE, PROT_READ | PROT_WRITE,
+             MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (s == NULL)
+    return 1;
+  for (pass = 0; pass < 2; pass++)
+    for (i = 0; i < STREAM_CNT; i++)
+      {
+        if (pass > 0 && s[i * PAGE] != (char) i)
+          return 2;
+        s[i * PAGE] = i;
+      }
+  return 0;
+}
+
+void
+test_main (void)
+{
+  struct vmstat before, after;
+  pid_t children[CHILD_CNT], streamer;
+  int i;
+
+  go = mmap2 (NULL, PAGE, PROT_READ | PROT_WRITE,
+              MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  cow = mmap2 (NULL, COW_CNT * PAGE, PROT_READ | PROT_WRITE,
+               MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  shared = mmap2 (NULL, SHARED_CNT * PAGE, PROT_READ | PROT_WRITE,
+                  MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  if (go == NULL || cow == NULL || shared == NULL)
+    fail ("mmap2 failed");
+  for (i = 0; i < COW_CNT; i++)
+    cow[i * PAGE] = i;
+  for (i = 0; i < SHARED_CNT; i++)
+    shared[i * PAGE] = i + 100;
+
+  for (i = 0; i < CHILD_CNT; i++)
+    {
+      children[i] = fork ();
+      if (children[i] == 0)
+        exit (reader (i));
+      if (children[i] == PID_ERROR)
+        fail ("fork");
+    }
+
+  CHECK (vmstat (VMSTAT_SYSTEM, &before), "vmstat");
+  streamer = fork ();
+  if (streamer == 0)
+    exit (stream ());
+  if (streamer == PID_ERROR)
+    fail ("fork");
+  CHECK (wait (streamer) == 0, "streaming child kept its data");
+  CHECK (vmstat (VMSTAT_SYSTEM, &after), "vmstat again");
+  CHECK (after.swap_outs - before.swap_outs >= STREAM_CNT / 2,
+         "pages swapped out");
+
+  *go = 1;
+  for (i = 0; i < CHILD_CNT; i++)
+    CHECK (wait (children[i]) == 0, "child %d saw its data", i);
+  for (i = 0; i < COW_CNT; i++)
+    if (cow[i * PAGE] != (char) i)
+      fail ("parent page %d changed", i);
+  msg ("parent kept its pages");
+  for (i = 0; i < SHARED_CNT; i++)
+    if (shared[i * PAGE] != -(i % CHILD_CNT) - 1)
+      fail ("shared page %d lost a child's write", i);
+  msg ("shared pages hold the children's writes");
+}
@@ -0,0 +1,18 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(rmap-evict) begin
+(rmap-evict) vmstat
+(rmap-evict) streaming child kept its data
+(rmap-evict) vmstat again
+(rmap-evict) pages swapped out
+(rmap-evict) child 0 saw its data
+(rmap-evict) child 1 saw its data
+(rmap-evict) child 2 saw its data
+(rmap-evict) parent kept its pages
+(rmap-evict) shared pages hold the children's writes
+(rmap-evict) end
+EOF
+pass;
@@ -0,0 +1,54 @@
+/* Writes 256 pages of anonymous memory under a hard limit of 64
+   resident pages and checks that the process stays within it and
+   keeps its data.  Then a forked child does the same inside a
+   memory group of 96 pages that it shares with its parent. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE 4096
+#define PAGE_CNT 256
+
+/* Maps PAGE_CNT pages, writes each, and checks them back.
+   Returns the mapping. */
+static char *
+fill_pages (void)
+{
+  char *p;
+  size_t i;
+
+  p = mmap2 (NULL, PAGE_CNT * PAGE, PROT_READ | PROT_WRITE,
+             MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (p == NULL)
+    fail ("mmap2 failed");
+  for (i = 0; i < PAGE_CNT; i++)
+    p[i * PAGE] = i;
+  for (i = 0; i < PAGE_CNT; i++)
+    if (p[i * PAGE] != (char) i)
+      fail ("page %zu lost its data", i);
+  return p;
+}
+
+void
+test_main (void)
+{
+  char *p;
+  pid_t child;
+
+  CHECK (!setrss (RSS_PROCESS, 10, 5), "soft limit above hard fails");
+  CHECK (setrss (RSS_PROCESS, 0, 64), "limit to 64 pages");
+  p = fill_pages ();
+  CHECK (getrss () <= 64, "resident pages within limit");
+  CHECK (munmap2 (p, PAGE_CNT * PAGE), "munmap2");
+
+  CHECK (setrss (RSS_PROCESS, 0, 0), "lift limit");
+  CHECK (setrss (RSS_GROUP, 0, 96), "enter group of 96 pages");
+  child = fork ();
+  if (child == 0)
+    {
+      fill_pages ();
+      exit (getrss () <= 96 ? 0 : 1);
+    }
+  CHECK (wait (child) == 0, "child within group limit");
+}
@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(rss-limit) begin
+(rss-limit) soft limit above hard fails
+(rss-limit) limit to 64 pages
+(rss-limit) resident pages within limit
+(rss-limit) munmap2
+(rss-limit) lift limit
+(rss-limit) enter group of 96 pages
+(rss-limit) child within group limit
+(rss-limit) end
+EOF
+pass;
@@ -0,0 +1,50 @@
+/* Fills a shared memory segment, unmaps and closes it, so that no
+   process maps its pages, then streams through more memory than
+   the user pool holds.  The unmapped segment pages must be swapped
+   out rather than kept in memory, and read back intact when the
+   segment is opened and mapped again. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE 4096
+#define SEG_CNT 64
+#define STREAM_CNT 192
+
+void
+test_main (void)
+{
+  struct vmstat before, after;
+  char *seg, *s;
+  int fd, i;
+
+  CHECK ((fd = shm_open ("seg", SHM_CREAT, SEG_CNT * PAGE)) > 1,
+         "shm_open \"seg\"");
+  CHECK ((seg = mmap2 (NULL, SEG_CNT * PAGE, PROT_READ | PROT_WRITE,
+                       MAP_SHARED, fd, 0)) != NULL, "mmap2 segment");
+  for (i = 0; i < SEG_CNT; i++)
+    seg[i * PAGE] = i;
+  CHECK (munmap2 (seg, SEG_CNT * PAGE), "munmap2 segment");
+  close (fd);
+
+  CHECK (vmstat (VMSTAT_SYSTEM, &before), "vmstat");
+  s = mmap2 (NULL, STREAM_CNT * PAGE, PROT_READ | PROT_WRITE,
+             MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (s == NULL)
+    fail ("mmap2 failed");
+  for (i = 0; i < STREAM_CNT; i++)
+    s[i * PAGE] = i;
+  CHECK (vmstat (VMSTAT_SYSTEM, &after), "vmstat again");
+  CHECK (after.evictions[4] > before.evictions[4],
+         "unmapped segment pages evicted");
+
+  CHECK ((fd = shm_open ("seg", 0, 0)) > 1, "shm_open \"seg\" again");
+  CHECK ((seg = mmap2 (NULL, SEG_CNT * PAGE, PROT_READ, MAP_SHARED, fd, 0))
+         != NULL, "mmap2 segment again");
+  for (i = 0; i < SEG_CNT; i++)
+    if (seg[i * PAGE] != (char) i)
+      fail ("segment page %d lost its data", i);
+  msg ("segment intact");
+  CHECK (shm_unlink ("seg"), "shm_unlink \"seg\"");
+}
@@ -0,0 +1,19 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(shm-swap) begin
+(shm-swap) shm_open "seg"
+(shm-swap) mmap2 segment
+(shm-swap) munmap2 segment
+(shm-swap) vmstat
+(shm-swap) vmstat again
+(shm-swap) unmapped segment pages evicted
+(shm-swap) shm_open "seg" again
+(shm-swap) mmap2 segment again
+(shm-swap) segment intact
+(shm-swap) shm_unlink "seg"
+(shm-swap) end
+EOF
+pass;
@@ -0,0 +1,73 @@
+/* Creates a named shared memory segment and an unnamed shared
+   anonymous mapping, and checks that a child's writes to both are
+   seen by the parent, that a segment can't be mapped privately or
+   past its end, and that shm_unlink() removes the name. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE 4096
+#define PAGE_CNT 4
+
+void
+test_main (void)
+{
+  char *seg, *anon;
+  int fd, i;
+  pid_t pid;
+
+  CHECK ((fd = shm_open ("seg", SHM_CREAT | SHM_EXCL, PAGE_CNT * PAGE)) > 1,
+         "shm_open \"seg\"");
+  CHECK (filesize (fd) == PAGE_CNT * PAGE, "segment size");
+  CHECK (shm_open ("seg", SHM_CREAT | SHM_EXCL, PAGE) == -1,
+         "exclusive create fails");
+  CHECK (mmap2 (NULL, PAGE, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0) == NULL,
+         "private mapping fails");
+  CHECK (mmap2 (NULL, 2 * PAGE, PROT_READ, MAP_SHARED, fd,
+                (PAGE_CNT - 1) * PAGE) == NULL,
+         "mapping past the end fails");
+  CHECK ((seg = mmap2 (NULL, PAGE_CNT * PAGE, PROT_READ | PROT_WRITE,
+                       MAP_SHARED, fd, 0)) != NULL, "mmap2 segment");
+  CHECK ((anon = mmap2 (NULL, PAGE_CNT * PAGE, PROT_READ | PROT_WRITE,
+                        MAP_SHARED | MAP_ANONYMOUS, -1, 0)) != NULL,
+         "mmap2 shared anonymous");
+  seg[0] = 'P';
+
+  pid = fork ();
+  if (pid == 0)
+    {
+      char *again;
+      int fd2 = shm_open ("seg", 0, 0);
+
+      if (seg[0] != 'P')
+        fail ("child does not see parent's write");
+      if (fd2 < 0)
+        fail ("child can't open \"seg\"");
+      again = mmap2 (NULL, PAGE, PROT_READ, MAP_SHARED, fd2, PAGE);
+      if (again == NULL)
+        fail ("child can't map \"seg\" again");
+      for (i = 0; i < PAGE_CNT; i++)
+        {
+          seg[i * PAGE + 1] = 'a' + i;
+          anon[i * PAGE] = 'A' + i;
+        }
+      if (again[1] != 'b')
+        fail ("second mapping does not see write");
+      exit (0x42);
+    }
+  if (pid == PID_ERROR)
+    fail ("fork");
+
+  CHECK (wait (pid) == 0x42, "wait for child");
+  for (i = 0; i < PAGE_CNT; i++)
+    if (seg[i * PAGE + 1] != 'a' + i || anon[i * PAGE] != 'A' + i)
+      fail ("page %d: child's write not seen", i);
+  msg ("check child's writes");
+
+  CHECK (shm_unlink ("seg"), "shm_unlink \"seg\"");
+  CHECK (shm_open ("seg", 0, 0) == -1, "open after unlink fails");
+  CHECK (seg[1] == 'a', "segment outlives its name");
+  close (fd);
+  CHECK (munmap2 (seg, PAGE_CNT * PAGE), "munmap2 segment");
+}
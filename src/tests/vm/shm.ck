@@ -0,0 +1,22 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(shm) begin
+(shm) shm_open "seg"
+(shm) segment size
+(shm) exclusive create fails
+(shm) private mapping fails
+(shm) mapping past the end fails
+(shm) mmap2 segment
+(shm) mmap2 shared anonymous
+(shm) wait for child
+(shm) check child's writes
+(shm) shm_unlink "seg"
+(shm) open after unlink fails
+(shm) segment outlives its name
+(shm) munmap2 segment
+(shm) end
+EOF
+pass;
@@ -0,0 +1,83 @@
+/* Fills far more anonymous pages than the user pool holds, so
+   that they take swap slots from several clusters, and forks a
+   child that shares those slots, reads them back and writes some
+   of them.  The parent's pages must be intact, and once they are
+   unmapped their slots must all be free again.  A second round
+   then reuses the freed slots. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE 4096
+#define PAGE_CNT 640
+#define CLUSTER 256             /* Slots per swap cluster. */
+
+/* Slots that the parent's own pages may hold between checks. */
+#define SLACK 16
+
+static int
+swap_used (void)
+{
+  struct vmstat st;
+
+  if (!vmstat (VMSTAT_SYSTEM, &st))
+    fail ("vmstat failed");
+  return st.swap_used;
+}
+
+static bool
+holds (const char *p, int c)
+{
+  int i;
+
+  for (i = 0; i < PAGE_CNT; i++)
+    if (p[i * PAGE] != (char) (c + i))
+      return false;
+  return true;
+}
+
+static void
+fill_round (int c)
+{
+  int before = swap_used ();
+  char *p;
+  pid_t child;
+  int i;
+
+  p = mmap2 (NULL, PAGE_CNT * PAGE, PROT_READ | PROT_WRITE,
+             MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (p == NULL)
+    fail ("mmap2 failed");
+  for (i = 0; i < PAGE_CNT; i++)
+    p[i * PAGE] = c + i;
+  CHECK (swap_used () - before >= 2 * CLUSTER,
+         "round %d: pages spread over several clusters", c);
+
+  child = fork ();
+  if (child == 0)
+    {
+      if (!holds (p, c))
+        exit (1);
+      for (i = 0; i < PAGE_CNT; i += 4)
+        p[i * PAGE] = -1;
+      for (i = 0; i < PAGE_CNT; i++)
+        if (p[i * PAGE] != (i % 4 == 0 ? -1 : (char) (c + i)))
+          exit (2);
+      exit (0);
+    }
+  if (child == PID_ERROR)
+    fail ("fork");
+  CHECK (wait (child) == 0, "round %d: child read the shared slots", c);
+  CHECK (holds (p, c), "round %d: parent pages intact", c);
+
+  CHECK (munmap2 (p, PAGE_CNT * PAGE), "round %d: munmap2", c);
+  CHECK (swap_used () <= before + SLACK, "round %d: slots freed", c);
+}
+
+void
+test_main (void)
+{
+  fill_round (1);
+  fill_round (2);
+}
@@ -0,0 +1,19 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(swap-clusters) begin
+(swap-clusters) round 1: pages spread over several clusters
+(swap-clusters) round 1: child read the shared slots
+(swap-clusters) round 1: parent pages intact
+(swap-clusters) round 1: munmap2
+(swap-clusters) round 1: slots freed
+(swap-clusters) round 2: pages spread over several clusters
+(swap-clusters) round 2: child read the shared slots
+(swap-clusters) round 2: parent pages intact
+(swap-clusters) round 2: munmap2
+(swap-clusters) round 2: slots freed
+(swap-clusters) end
+EOF
+pass;
@@ -0,0 +1,42 @@
+/* Touches 32 pages of anonymous memory and checks that the
+   process's fault counters grew by at least that much, that they
+   add up, and that they never exceed the system-wide ones. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE 4096
+#define PAGE_CNT 32
+
+void
+test_main (void)
+{
+  struct vmstat before, after, sys;
+  char *p;
+  size_t i;
+
+  CHECK (!vmstat (2, &before), "bad scope fails");
+  CHECK (vmstat (VMSTAT_PROCESS, &before), "vmstat process");
+  p = mmap2 (NULL, PAGE_CNT * PAGE, PROT_READ | PROT_WRITE,
+             MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (p == NULL)
+    fail ("mmap2 failed");
+  for (i = 0; i < PAGE_CNT; i++)
+    p[i * PAGE] = i;
+  CHECK (vmstat (VMSTAT_PROCESS, &after), "vmstat process again");
+  CHECK (vmstat (VMSTAT_SYSTEM, &sys), "vmstat system");
+
+  CHECK (after.type_faults[0] - before.type_faults[0] >= PAGE_CNT,
+         "zero page faults counted");
+  CHECK (after.minor_faults + after.major_faults
+         == after.type_faults[0] + after.type_faults[1]
+            + after.type_faults[2] + after.type_faults[3]
+            + after.type_faults[4],
+         "faults by type add up");
+  CHECK (after.faults >= after.minor_faults + after.major_faults,
+         "resolved faults within all faults");
+  CHECK (after.resident >= PAGE_CNT, "pages resident");
+  CHECK (sys.faults >= after.faults && sys.resident >= after.resident,
+         "process within system");
+}
@@ -0,0 +1,18 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(vmstat) begin
+(vmstat) bad scope fails
+(vmstat) vmstat process
+(vmstat) vmstat process again
+(vmstat) vmstat system
+(vmstat) zero page faults counted
+(vmstat) faults by type add up
+(vmstat) resolved faults within all faults
+(vmstat) pages resident
+(vmstat) process within system
+(vmstat) end
+EOF
+pass;
@@ -0,0 +1,73 @@
+/* Keeps using 16 pages while a child streams through far more
+   memory than the user pool holds, so that the clock hand keeps
+   clearing the accessed bits of the used pages between idle
+   scans, and checks that the working set estimate still counts
+   them as used. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE 4096
+#define HOT_CNT 16
+#define STREAM_CNT 256
+
+void
+test_main (void)
+{
+  volatile int *stop;
+  volatile char *p;
+  struct wss w;
+  int start, hot, i;
+  pid_t child;
+
+  stop = mmap2 (NULL, PAGE, PROT_READ | PROT_WRITE,
+                MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  p = mmap2 (NULL, HOT_CNT * PAGE, PROT_READ | PROT_WRITE,
+             MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (stop == NULL || p == NULL)
+    fail ("mmap2 failed");
+
+  child = fork ();
+  if (child == 0)
+    {
+      volatile char *s = mmap2 (NULL, STREAM_CNT * PAGE,
+                                PROT_READ | PROT_WRITE,
+                                MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+      int pass;
+
+      if (s == NULL)
+        exit (1);
+      for (pass = 0; !*stop; pass++)
+        for (i = 0; i < STREAM_CNT; i++)
+          {
+            if (pass > 0 && s[i * PAGE] != (char) (pass - 1 + i))
+              exit (2);
+            s[i * PAGE] = pass + i;
+          }
+      exit (0);
+    }
+  if (child == PID_ERROR)
+    fail ("fork");
+
+  for (i = 0; i < HOT_CNT; i++)
+    p[i * PAGE] = i;
+  CHECK (wss (&w), "wss");
+  start = w.scans;
+  while (w.scans < start + 4)
+    {
+      for (i = 0; i < HOT_CNT; i++)
+        p[i * PAGE]++;
+      if (!wss (&w))
+        fail ("wss failed");
+    }
+  *stop = 1;
+
+  /* The used pages were touched just before the last call, so
+     none can have been found idle by more than the scan that may
+     have run since. */
+  hot = w.idle[0] + w.idle[1];
+  CHECK (w.resident >= HOT_CNT, "used pages resident");
+  CHECK (hot >= HOT_CNT, "used pages in working set");
+  CHECK (wait (child) == 0, "streaming child kept its data");
+}
@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(wss-pressure) begin
+(wss-pressure) wss
+(wss-pressure) used pages resident
+(wss-pressure) used pages in working set
+(wss-pressure) streaming child kept its data
+(wss-pressure) end
+EOF
+pass;
@@ -0,0 +1,44 @@
+/* Touches 64 pages of anonymous memory, then keeps using only 16
+   of them while the idle page tracker scans, and checks that the
+   working set estimate tells the two apart. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE 4096
+#define PAGE_CNT 64
+#define HOT_CNT 16
+
+void
+test_main (void)
+{
+  struct wss w;
+  volatile char *p;
+  int start, hot, i;
+
+  p = mmap2 (NULL, PAGE_CNT * PAGE, PROT_READ | PROT_WRITE,
+             MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (p == NULL)
+    fail ("mmap2 failed");
+  for (i = 0; i < PAGE_CNT; i++)
+    p[i * PAGE] = i;
+
+  CHECK (wss (&w), "wss");
+  start = w.scans;
+  while (w.scans < start + 4)
+    {
+      for (i = 0; i < HOT_CNT; i++)
+        p[i * PAGE]++;
+      if (!wss (&w))
+        fail ("wss failed");
+    }
+
+  /* Pages used within the last 2 scans.  The last 3 scans all
+     found the unused pages idle. */
+  hot = w.idle[0] + w.idle[1];
+  CHECK (w.period > 0, "tracker running");
+  CHECK (w.resident >= PAGE_CNT, "pages resident");
+  CHECK (hot >= HOT_CNT, "used pages in working set");
+  CHECK (w.resident - hot >= PAGE_CNT - HOT_CNT, "unused pages idle");
+}
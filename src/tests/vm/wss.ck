@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(wss) begin
+(wss) wss
+(wss) tracker running
+(wss) pages resident
+(wss) used pages in working set
+(wss) unused pages idle
+(wss) end
+EOF
+pass;
@@ -0,0 +1,99 @@
+/* Fills more pages than the user pool holds with each kind of
+   data the compressed swap cache stores differently: same-filled
+   pages, sparse pages, pages with runs of nonzero words longer
+   than one compressed run, and random pages that do not compress.
+   The cache is kept small enough that most of it spills to the
+   swap device.  Then checks every page, rewrites half of them and
+   checks every page again. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/arc4.h"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE 4096
+#define PAGE_CNT 256
+#define WORD_CNT (PAGE / sizeof (unsigned))
+
+static unsigned expected[WORD_CNT];
+
+/* Fills PAGE with generation GEN of the contents of page I. */
+static void
+fill (unsigned *page, int i, int gen)
+{
+  struct arc4 arc4;
+  int key[2];
+  size_t j;
+
+  memset (page, 0, PAGE);
+  switch (i % 4)
+    {
+    case 0:
+      /* Same-filled. */
+      for (j = 0; j < WORD_CNT; j++)
+        page[j] = i * 0x01010101u + gen;
+      break;
+    case 1:
+      /* Sparse, up to the last word. */
+      for (j = i % 7; j < WORD_CNT; j += 61)
+        page[j] = j + gen + 1;
+      page[WORD_CNT - 1] = i + gen;
+      break;
+    case 2:
+      /* One long run of nonzero words. */
+      for (j = 100; j < 400; j++)
+        page[j] = j * 7 + gen;
+      break;
+    case 3:
+      /* Random. */
+      key[0] = i;
+      key[1] = gen;
+      arc4_init (&arc4, key, sizeof key);
+      arc4_crypt (&arc4, page, PAGE);
+      break;
+    }
+}
+
+/* Returns the generation page I holds after ROUND rewrites. */
+static int
+generation (int i, int round)
+{
+  return round > 0 && (i / 4) % 2 == 0;
+}
+
+static void
+verify (unsigned *p, int round)
+{
+  int i;
+
+  for (i = 0; i < PAGE_CNT; i++)
+    {
+      fill (expected, i, generation (i, round));
+      if (memcmp (p + i * WORD_CNT, expected, PAGE))
+        fail ("page %d differs in round %d", i, round);
+    }
+}
+
+void
+test_main (void)
+{
+  unsigned *p;
+  int i;
+
+  p = mmap2 (NULL, PAGE_CNT * PAGE, PROT_READ | PROT_WRITE,
+             MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (p == NULL)
+    fail ("mmap2 failed");
+
+  for (i = 0; i < PAGE_CNT; i++)
+    fill (p + i * WORD_CNT, i, 0);
+  verify (p, 0);
+  msg ("pages intact");
+
+  for (i = 0; i < PAGE_CNT; i++)
+    if (generation (i, 1))
+      fill (p + i * WORD_CNT, i, 1);
+  verify (p, 1);
+  msg ("rewritten pages intact");
+}
@@ -0,0 +1,11 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(zswap) begin
+(zswap) pages intact
+(zswap) rewritten pages intact
+(zswap) end
+EOF
+pass;
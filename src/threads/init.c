@@ -37,12 +37,27 @@
 #include "filesys/filesys.h"
 #include "filesys/fsutil.h"
 #endif
+#include "vm/faultstat.h"
 #include "vm/frame.h"
+#include "vm/ksm.h"
+#include "vm/page.h"
+#include "vm/rss.h"
+#include "vm/shm.h"
 #include "vm/swap.h"
+#include "vm/wss.h"
+#include "vm/zswap.h"
+
+/* CR4 bit that enables 4 MB pages, and the CPUID feature flag,
+   in EDX of leaf 1, that says the CPU has them. */
+#define CR4_PSE 0x00000010
+#define CPUID_PSE 0x00000008
 
 /* Page directory with kernel mappings only. */
 uint32_t *init_page_dir;
 
+/* True if the CPU supports 4 MB pages and they are enabled. */
+bool pse_enabled;
+
 #ifdef FILESYS
 /* -f: Format the file system? */
 static bool format_filesys;
@@ -129,7 +144,11 @@ int main(void)
 #endif
 
     frame_init();
+    rss_init();
     swap_init();
+    shm_init();
+    ksm_init();
+    wss_init();
 
     printf("Boot complete.\n");
 
@@ -154,10 +173,28 @@ bss_init(void)
     memset(&_start_bss, 0, &_end_bss - &_start_bss);
 }
 
+/* Returns true if the CPU supports 4 MB pages, according to
+   CPUID.  See [IA32-v3a] 3.7.3 "Mixing 4-KByte and 4-MByte
+   Pages". */
+static bool
+cpu_has_pse(void)
+{
+    uint32_t eax = 1, ebx, ecx, edx;
+
+    asm volatile("cpuid"
+                 : "+a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx));
+    return (edx & CPUID_PSE) != 0;
+}
+
 /* Populates the base page directory and page table with the
    kernel virtual mapping, and then sets up the CPU to use the
    new page directory.  Points init_page_dir to the page
-   directory it creates. */
+   directory it creates.
+
+   If the CPU supports it, every 4 MB of RAM that holds no kernel
+   code is mapped by a single 4 MB page, which takes one TLB entry
+   instead of 1,024.  The rest keeps 4 kB pages so that the kernel
+   text stays read-only. */
 static void
 paging_init(void)
 {
@@ -165,6 +202,18 @@ paging_init(void)
     size_t page;
     extern char _start, _end_kernel_text;
 
+    pse_enabled = cpu_has_pse();
+    if (pse_enabled)
+    {
+        uint32_t cr4;
+
+        asm volatile("movl %%cr4, %0"
+                     : "=r"(cr4));
+        asm volatile("movl %0, %%cr4"
+                     :
+                     : "r"(cr4 | CR4_PSE));
+    }
+
     pd = init_page_dir = palloc_get_page(PAL_ASSERT | PAL_ZERO);
     pt = NULL;
     for (page = 0; page < init_ram_pages; page++)
@@ -175,6 +224,15 @@ paging_init(void)
         size_t pte_idx = pt_no(vaddr);
         bool in_kernel_text = &_start <= vaddr && vaddr < &_end_kernel_text;
 
+        if (pse_enabled && pte_idx == 0
+            && page + (1 << PTBITS) <= init_ram_pages
+            && (vaddr + PTSPAN <= &_start || vaddr >= &_end_kernel_text))
+        {
+            pd[pde_idx] = pde_create_large(vaddr, true, false);
+            page += (1 << PTBITS) - 1;
+            continue;
+        }
+
         if (pd[pde_idx] == 0)
         {
             pt = palloc_get_page(PAL_ASSERT | PAL_ZERO);
@@ -256,6 +314,35 @@ parse_options(char **argv)
 #ifdef VM
         else if (!strcmp(name, "-swap"))
             swap_bdev_name = value;
+        else if (!strcmp(name, "-fault-around"))
+            page_fault_around = atoi(value);
+        else if (!strcmp(name, "-zswap"))
+            zswap_max_pages = atoi(value);
+        else if (!strcmp(name, "-evict"))
+        {
+            if (!frame_set_policy(value))
+                PANIC("unknown eviction policy `%s' (use -h for help)", value);
+        }
+        else if (!strcmp(name, "-evict-spread"))
+            frame_hand_spread = atoi(value);
+        else if (!strcmp(name, "-large-pages"))
+            page_large_pages = true;
+        else if (!strcmp(name, "-rss-limit"))
+            rss_default_limit = atoi(value);
+        else if (!strcmp(name, "-ksm"))
+            ksm_scan_rate = atoi(value);
+        else if (!strcmp(name, "-stack-window"))
+            page_stack_window = atoi(value);
+        else if (!strcmp(name, "-eager-load"))
+            page_eager_load = atoi(value);
+        else if (!strcmp(name, "-swap-bench"))
+            swap_run_bench = true;
+        else if (!strcmp(name, "-wss"))
+            wss_period = atoi(value);
+        else if (!strcmp(name, "-wss-reclaim"))
+            wss_reclaim_age = atoi(value);
+        else if (!strcmp(name, "-fault-trace"))
+            faultstat_trace_max = atoi(value);
 #endif
 #endif
         else if (!strcmp(name, "-rs"))
@@ -380,6 +467,19 @@ usage(void)
            "  -scratch=BDEV      Use BDEV for scratch instead of default.\n"
 #ifdef VM
            "  -swap=BDEV         Use BDEV for swap instead of default.\n"
+           "  -fault-around=N    Map up to N file pages per read fault.\n"
+           "  -zswap=N           Keep up to N pages of compressed swap in RAM.\n"
+           "  -evict=POLICY      Evict with clock (default), wsclock, clock2 or 2q.\n"
+           "  -evict-spread=N    Keep clock2's hands N frames apart.\n"
+           "  -large-pages       Back aligned 4 MB anonymous regions with 4 MB pages.\n"
+           "  -rss-limit=N       Keep each process to N resident pages by default.\n"
+           "  -ksm=N             Merge identical pages, scanning N frames per 100 ms.\n"
+           "  -stack-window=N    Map up to N stack pages per stack growth fault.\n"
+           "  -eager-load=N      Map data segments up to N pages at exec; 0 for none.\n"
+           "  -swap-bench        Time the swap slot allocator at boot.\n"
+           "  -wss=MS            Track idle pages, scanning every MS ms.\n"
+           "  -wss-reclaim=N     Evict pages idle for N scans; 0 for never.\n"
+           "  -fault-trace=N     Keep the N slowest page faults, up to 16.\n"
 #endif
 #endif
            "  -rs=SEED           Set random number seed to SEED.\n"
@@ -9,4 +9,7 @@
 /* Page directory with kernel mappings only. */
 extern uint32_t *init_page_dir;
 
+/* True if the CPU supports 4 MB pages and they are enabled. */
+extern bool pse_enabled;
+
 #endif /* threads/init.h */
@@ -99,6 +99,45 @@ palloc_get_multiple(enum palloc_flags flags, size_t page_cnt)
     return pages;
 }
 
+/* Like palloc_get_multiple(), but the PAGE_CNT pages start at a
+   physical address that is a multiple of ALIGN pages, as a 4 MB
+   page requires. */
+void *
+palloc_get_aligned(enum palloc_flags flags, size_t page_cnt, size_t align)
+{
+    struct pool *pool = flags & PAL_USER ? &user_pool : &kernel_pool;
+    void *pages = NULL;
+    size_t page_idx;
+
+    ASSERT(align > 0);
+    if (page_cnt == 0)
+        return NULL;
+
+    lock_acquire(&pool->lock);
+    page_idx = (align - pg_no(pool->base) % align) % align;
+    for (; page_idx + page_cnt <= bitmap_size(pool->used_map); page_idx += align)
+        if (bitmap_none(pool->used_map, page_idx, page_cnt))
+        {
+            bitmap_set_multiple(pool->used_map, page_idx, page_cnt, true);
+            pages = pool->base + PGSIZE * page_idx;
+            break;
+        }
+    lock_release(&pool->lock);
+
+    if (pages != NULL)
+    {
+        if (flags & PAL_ZERO)
+            memset(pages, 0, PGSIZE * page_cnt);
+    }
+    else
+    {
+        if (flags & PAL_ASSERT)
+            PANIC("palloc_get: out of pages");
+    }
+
+    return pages;
+}
+
 /* Obtains a single free page and returns its kernel virtual
    address.
    If PAL_USER is set, the page is obtained from the user pool,
@@ -53,7 +53,9 @@ static inline uintptr_t pd_no(const void *va)
    |         Physical Address           |         Flags          |
    +------------------------------------+------------------------+
 
-   In a PDE, the physical address points to a page table.
+   In a PDE, the physical address points to a page table, unless
+   PTE_PS is set, in which case bits 31:22 are the address of a
+   4 MB page.
    In a PTE, the physical address points to a data or code page.
    The important flags are listed below.
    When a PDE or PTE is not "present", the other flags are
@@ -68,6 +70,8 @@ static inline uintptr_t pd_no(const void *va)
 #define PTE_U 0x4            /* 1=user/kernel, 0=kernel only. */
 #define PTE_A 0x20           /* 1=accessed, 0=not acccessed. */
 #define PTE_D 0x40           /* 1=dirty, 0=not dirty (PTEs only). */
+#define PTE_PS 0x80          /* 1=4 MB page, 0=page table (PDEs only). */
+#define PDE_LARGE_ADDR 0xffc00000 /* Address bits of a 4 MB page. */
 
 /* Returns a PDE that points to page table PT. */
 static inline uint32_t pde_create(uint32_t *pt)
@@ -84,6 +88,24 @@ static inline uint32_t *pde_get_pt(uint32_t pde)
     return ptov(pde & PTE_ADDR);
 }
 
+/* Returns a PDE that maps the 4 MB page starting at PAGE, which
+   must be 4 MB aligned, like a PTE made by pte_create_kernel()
+   or, if USER, pte_create_user().
+   Only valid once CR4.PSE is set. */
+static inline uint32_t pde_create_large(void *page, bool writable, bool user)
+{
+    ASSERT((vtop(page) & ~PDE_LARGE_ADDR) == 0);
+    return vtop(page) | PTE_PS | PTE_P | (writable ? PTE_W : 0) | (user ? PTE_U : 0);
+}
+
+/* Returns a pointer to the 4 MB page that PDE, which must have
+   PTE_PS set, maps. */
+static inline void *pde_get_large_page(uint32_t pde)
+{
+    ASSERT(pde & PTE_PS);
+    return ptov(pde & PDE_LARGE_ADDR);
+}
+
 /* Returns a PTE that points to PAGE.
    The PTE's page is readable.
    If WRITABLE is true then it will be writable as well.
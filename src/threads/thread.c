@@ -658,8 +658,9 @@ init_thread(struct thread *t, const char *name, int priority)
     list_init(&t->fdt);
     t->next_fd = 2;
 #endif
-    list_init(&t->file_mapping_list);
+    t->vmas = NULL;
     t->pages = NULL;
+    t->fault_clock = NULL;
     t->magic = THREAD_MAGIC;
 
     old_level = intr_disable();
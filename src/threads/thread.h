@@ -107,8 +107,8 @@ struct thread
     int nice;       /* Figure that indicates how nice to others. */
     int recent_cpu; /* Weighted average amount of received CPU time. */
 
-    int number_mapped;
-    struct list file_mapping_list;
+    int number_mapped;         /* Next mapid for mmap(). */
+    struct vma *vmas;          /* Tree of memory mappings. */
 
 #ifdef USERPROG
     /* Shared between userprog/process.c and userprog/syscall.c. */
@@ -118,9 +118,11 @@ struct thread
     struct list fdt;           /* List of file descriptor entries. */
     int next_fd;               /* File descriptor for next file. */
     struct file *running_file; /* Currently running file. */
+    void *user_esp;            /* User stack pointer in system calls. */
 #endif
 
-   struct hash *pages;  /* Project 3 virtual pages */
+   struct page_table *pages;  /* Project 3 virtual pages */
+    struct fault_clock *fault_clock; /* Timing of the page fault being handled. */
 
     /* Owned by thread.c. */
     unsigned magic; /* Detects stack overflow. */
@@ -3,19 +3,20 @@
 #include <stdio.h>
 #include "userprog/gdt.h"
 #include "userprog/syscall.h"
+#include "userprog/uaccess.h"
 #include "threads/interrupt.h"
 #include "threads/thread.h"
 #include "threads/vaddr.h"
+#include "vm/faultstat.h"
 #include "vm/page.h"
-
-#define STACK_SIZE (8 * (1 << 20))
+#include "vm/vmstat.h"
 
 /* Number of page faults processed. */
 static long long page_fault_cnt;
 
 static void kill(struct intr_frame *);
 static void page_fault(struct intr_frame *);
-static bool is_stack_access(int32_t addr, uint32_t* esp);
+static void count_fault(void *upage, enum page_type type, bool major);
 
 /* Registers handlers for interrupts that can be caused by user
    programs.
@@ -153,19 +154,58 @@ page_fault(struct intr_frame *f)
     write = (f->error_code & PF_W) != 0;
     user = (f->error_code & PF_U) != 0;
 
-    if(fault_addr == NULL || !not_present || !is_user_vaddr(fault_addr))
-        syscall_exit(-1);
-
-    if(is_stack_access(fault_addr, f->esp))
+    if(fault_addr != NULL && is_user_vaddr(fault_addr))
     {
-        if(!page_create_with_zero(pg_round_down(fault_addr)))
-            syscall_exit(-1);
+        void* upage = pg_round_down(fault_addr);
+        struct fault_clock clock;
+        struct page* p;
+
+        VMSTAT_ADD(thread_current(), faults, 1);
+        faultstat_begin(&clock);
+
+        /* Writes to pages shared copy-on-write after fork() or
+           mapped onto the zero frame. */
+        if(!not_present)
+        {
+            p = page_find_by_upage(upage);
+            if(write && p != NULL && page_unshare(upage))
+            {
+                count_fault(upage, p->type, false);
+                return;
+            }
+        }
+        else
+        {
+            /* The kernel touches user memory only in system calls,
+               where the user's stack pointer was saved. */
+            void* esp = user ? f->esp : thread_current()->user_esp;
+            enum page_type type;
+            bool major;
+
+            p = page_find_by_upage(upage);
+            if(p == NULL && page_grow_stack(fault_addr, esp))
+            {
+                p = page_find_by_upage(upage);
+                VMSTAT_ADD(thread_current(), stack_faults, 1);
+            }
+
+            /* Loading changes the page's type, so classify first. */
+            type = p != NULL ? p->type : PAGE_ZERO;
+            major = p != NULL && page_is_major(p);
+            if(write ? page_load(upage) : page_load_around(upage))
+            {
+                count_fault(upage, type, major);
+                return;
+            }
+        }
+        faultstat_end(upage, PAGE_ZERO, false);
     }
 
-    if(page_load(pg_round_down(fault_addr)))
-       return;
-    else 
-        syscall_exit(-1);    
+    /* A bad user address passed to a system call fails the
+       uaccess primitive that touched it. */
+    if(!user && uaccess_fixup(f))
+        return;
+    syscall_exit(-1);
 
     /* To implement virtual memory, delete the rest of the function
      body, and replace it with code that brings in the page to
@@ -178,10 +218,17 @@ page_fault(struct intr_frame *f)
     kill(f);
 }
 
-static bool
-is_stack_access(int32_t fault_addr, uint32_t* esp)
+/* Counts a page fault at UPAGE resolved on a page of the given
+   TYPE, which read its file or swap slot if MAJOR. */
+static void
+count_fault(void *upage, enum page_type type, bool major)
 {
-    return fault_addr >= (esp - 32) && 
-            (PHYS_BASE - pg_round_down(fault_addr)) <= STACK_SIZE && 
-            page_find_by_upage(pg_round_down(fault_addr)) == NULL;
+    struct thread* t = thread_current();
+
+    faultstat_end(upage, type, true);
+    VMSTAT_ADD(t, type_faults[type], 1);
+    if(major)
+        VMSTAT_ADD(t, major_faults, 1);
+    else
+        VMSTAT_ADD(t, minor_faults, 1);
 }
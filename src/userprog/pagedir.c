@@ -1,13 +1,30 @@
 #include "userprog/pagedir.h"
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdio.h>
 #include <string.h>
 #include "threads/init.h"
+#include "threads/interrupt.h"
 #include "threads/pte.h"
 #include "threads/palloc.h"
 
 static uint32_t *active_pd(void);
 static void invalidate_pagedir(uint32_t *);
+static void invalidate_page(uint32_t *, const void *);
+static void split_large_page(uint32_t *, const void *);
+static void reserve_push(uint32_t *);
+static uint32_t *reserve_pop(void);
+
+/* Statistics: whole TLB flushes and single pages invalidated. */
+static long long flush_cnt, invlpg_cnt;
+
+/* Page tables set aside for splitting 4 MB pages, one for each 4
+   MB page mapped, linked through their first entries.  Splitting
+   happens while unmapping, write-protecting and evicting, with
+   the frame lock held, where running out of memory cannot be
+   handled, so the page table is allocated when the 4 MB page is
+   mapped instead. */
+static uint32_t *pt_reserve;
 
 /* Creates a new page directory that has mappings for kernel
    virtual addresses, but none for user virtual addresses.
@@ -22,8 +39,10 @@ pagedir_create(void)
     return pd;
 }
 
-/* Destroys page directory PD, freeing all the pages it
-   references. */
+/* Destroys page directory PD, freeing its page tables.  The
+   frames its user pages map belong to the frame table, which
+   releases them without unmapping them when a process exits (see
+   page_exit()), so they are left alone. */
 void pagedir_destroy(uint32_t *pd)
 {
     uint32_t *pde;
@@ -33,16 +52,10 @@ void pagedir_destroy(uint32_t *pd)
 
     ASSERT(pd != init_page_dir);
     for (pde = pd; pde < pd + pd_no(PHYS_BASE); pde++)
-        if (*pde & PTE_P)
-        {
-            uint32_t *pt = pde_get_pt(*pde);
-            uint32_t *pte;
-
-            for (pte = pt; pte < pt + PGSIZE / sizeof *pte; pte++)
-                if (*pte & PTE_P)
-                    palloc_free_page(pte_get_page(*pte));
-            palloc_free_page(pt);
-        }
+        if ((*pde & (PTE_P | PTE_PS)) == PTE_P)
+            palloc_free_page(pde_get_pt(*pde));
+        else if (*pde & PTE_PS)
+            palloc_free_page(reserve_pop());
     palloc_free_page(pd);
 }
 
@@ -51,7 +64,10 @@ void pagedir_destroy(uint32_t *pd)
    If PD does not have a page table for VADDR, behavior depends
    on CREATE.  If CREATE is true, then a new page table is
    created and a pointer into it is returned.  Otherwise, a null
-   pointer is returned. */
+   pointer is returned.
+   If VADDR lies in a 4 MB page, returns the PDE itself, whose
+   flags are laid out like a PTE's; callers that change a single
+   4 kB page must split_large_page() first. */
 static uint32_t *
 lookup_page(uint32_t *pd, const void *vaddr, bool create)
 {
@@ -65,6 +81,8 @@ lookup_page(uint32_t *pd, const void *vaddr, bool create)
     /* Check for a page table for VADDR.
      If one is missing, create one if requested. */
     pde = pd + pd_no(vaddr);
+    if (*pde & PTE_PS)
+        return pde;
     if (*pde == 0)
     {
         if (create)
@@ -104,6 +122,7 @@ bool pagedir_set_page(uint32_t *pd, void *upage, void *kpage, bool writable)
     ASSERT(vtop(kpage) >> PTSHIFT < init_ram_pages);
     ASSERT(pd != init_page_dir);
 
+    split_large_page(pd, upage);
     pte = lookup_page(pd, upage, true);
 
     if (pte != NULL)
@@ -128,7 +147,9 @@ pagedir_get_page(uint32_t *pd, const void *uaddr)
     ASSERT(is_user_vaddr(uaddr));
 
     pte = lookup_page(pd, uaddr, false);
-    if (pte != NULL && (*pte & PTE_P) != 0)
+    if (pte != NULL && (*pte & (PTE_P | PTE_PS)) == (PTE_P | PTE_PS))
+        return pde_get_large_page(*pte) + ((uintptr_t)uaddr & (PTSPAN - 1));
+    else if (pte != NULL && (*pte & PTE_P) != 0)
         return pte_get_page(*pte) + pg_ofs(uaddr);
     else
         return NULL;
@@ -145,11 +166,101 @@ void pagedir_clear_page(uint32_t *pd, void *upage)
     ASSERT(pg_ofs(upage) == 0);
     ASSERT(is_user_vaddr(upage));
 
+    split_large_page(pd, upage);
     pte = lookup_page(pd, upage, false);
     if (pte != NULL && (*pte & PTE_P) != 0)
     {
         *pte &= ~PTE_P;
-        invalidate_pagedir(pd);
+        invalidate_page(pd, upage);
+    }
+}
+
+/* Marks the user virtual pages from START up to END "not
+   present" in PD, like pagedir_clear_page(), with one TLB flush
+   for the run.  Skips the 4 MB regions that have no page table.
+   The pages need not be mapped. */
+void pagedir_clear_range(uint32_t *pd, void *start, void *end)
+{
+    struct pagedir_batch batch;
+    uint8_t *upage = start;
+
+    ASSERT(pg_ofs(start) == 0);
+    ASSERT(end <= PHYS_BASE);
+
+    pagedir_batch_init(&batch, pd);
+    while (upage < (uint8_t *)end)
+    {
+        if ((pd[pd_no(upage)] & PTE_P) == 0)
+            upage = (uint8_t *)(((uintptr_t)upage & ~(PTSPAN - 1)) + PTSPAN);
+        else
+        {
+            pagedir_batch_clear(&batch, upage);
+            upage += PGSIZE;
+        }
+    }
+    pagedir_batch_flush(&batch);
+}
+
+/* Starts an empty batch of pages unmapped from PD. */
+void pagedir_batch_init(struct pagedir_batch *batch, uint32_t *pd)
+{
+    batch->pd = pd;
+    batch->cnt = 0;
+}
+
+/* Marks user virtual page UPAGE "not present" in the batch's page
+   directory, like pagedir_clear_page(), but leaves its TLB entry
+   for pagedir_batch_flush() to invalidate.  Until then the
+   current process must not touch UPAGE. */
+void pagedir_batch_clear(struct pagedir_batch *batch, void *upage)
+{
+    uint32_t *pte;
+
+    ASSERT(pg_ofs(upage) == 0);
+    ASSERT(is_user_vaddr(upage));
+
+    split_large_page(batch->pd, upage);
+    pte = lookup_page(batch->pd, upage, false);
+    if (pte != NULL && (*pte & PTE_P) != 0)
+    {
+        *pte &= ~PTE_P;
+        if (batch->cnt < PAGEDIR_BATCH)
+            batch->pages[batch->cnt] = upage;
+        batch->cnt++;
+    }
+}
+
+/* Invalidates the TLB entries of the pages unmapped through
+   BATCH, one at a time if there are at most PAGEDIR_BATCH of
+   them and with one flush otherwise, and empties it. */
+void pagedir_batch_flush(struct pagedir_batch *batch)
+{
+    size_t i;
+
+    if (batch->cnt > PAGEDIR_BATCH)
+        invalidate_pagedir(batch->pd);
+    else
+        for (i = 0; i < batch->cnt; i++)
+            invalidate_page(batch->pd, batch->pages[i]);
+    batch->cnt = 0;
+}
+
+/* Sets the writable bit to WRITABLE in the PTE for virtual page
+   VPAGE in PD.  Used to share pages copy-on-write. */
+void pagedir_set_writable(uint32_t *pd, const void *vpage, bool writable)
+{
+    uint32_t *pte = lookup_page(pd, vpage, false);
+    if (pte != NULL && ((*pte & PTE_W) != 0) == writable)
+        return;
+    split_large_page(pd, vpage);
+    pte = lookup_page(pd, vpage, false);
+    if (pte != NULL && (*pte & PTE_P) != 0)
+    {
+        if (writable)
+            *pte |= PTE_W;
+        else
+            *pte &= ~(uint32_t)PTE_W;
+        invalidate_page(pd, vpage);
     }
 }
 
@@ -167,7 +278,13 @@ bool pagedir_is_dirty(uint32_t *pd, const void *vpage)
    in PD. */
 void pagedir_set_dirty(uint32_t *pd, const void *vpage, bool dirty)
 {
-    uint32_t *pte = lookup_page(pd, vpage, false);
+    uint32_t *pte;
+
+    /* A 4 MB page has one dirty bit; clearing it for one 4 kB page
+       would lose the others' modifications. */
+    if (!dirty)
+        split_large_page(pd, vpage);
+    pte = lookup_page(pd, vpage, false);
     if (pte != NULL)
     {
         if (dirty)
@@ -175,7 +292,7 @@ void pagedir_set_dirty(uint32_t *pd, const void *vpage, bool dirty)
         else
         {
             *pte &= ~(uint32_t)PTE_D;
-            invalidate_pagedir(pd);
+            invalidate_page(pd, vpage);
         }
     }
 }
@@ -194,7 +311,15 @@ bool pagedir_is_accessed(uint32_t *pd, const void *vpage)
    VPAGE in PD. */
 void pagedir_set_accessed(uint32_t *pd, const void *vpage, bool accessed)
 {
-    uint32_t *pte = lookup_page(pd, vpage, false);
+    uint32_t *pte;
+
+    /* A 4 MB page has one accessed bit for its 1024 frames, so the
+       clock and idle page tracking would see them all used or all
+       idle.  The first time it is cleared, the page is split and
+       its 4 kB pages are aged one at a time from then on. */
+    if (!accessed)
+        split_large_page(pd, vpage);
+    pte = lookup_page(pd, vpage, false);
     if (pte != NULL)
     {
         if (accessed)
@@ -202,11 +327,101 @@ void pagedir_set_accessed(uint32_t *pd, const void *vpage, bool accessed)
         else
         {
             *pte &= ~(uint32_t)PTE_A;
-            invalidate_pagedir(pd);
+            invalidate_page(pd, vpage);
         }
     }
 }
 
+/* Maps the 4 MB region of user virtual memory starting at UPAGE
+   in PD to the physically contiguous 4 MB page starting at KPAGE,
+   with a single page directory entry.  Both must be 4 MB
+   aligned, and no page of the region may be mapped yet.  An
+   empty page table left behind for the region, or else a new
+   one, is set aside for split_large_page().
+   Returns false, mapping nothing, if no page table can be
+   allocated. */
+bool pagedir_set_large_page(uint32_t *pd, void *upage, void *kpage, bool writable)
+{
+    uint32_t *pde = pd + pd_no(upage);
+    uint32_t *pt;
+
+    ASSERT(((uintptr_t)upage & (PTSPAN - 1)) == 0);
+    ASSERT(is_user_vaddr(upage));
+    ASSERT(pse_enabled);
+
+    if (*pde & PTE_P)
+    {
+        uint32_t *pte;
+
+        ASSERT((*pde & PTE_PS) == 0);
+        pt = pde_get_pt(*pde);
+        for (pte = pt; pte < pt + PGSIZE / sizeof *pte; pte++)
+            ASSERT((*pte & PTE_P) == 0);
+    }
+    else
+    {
+        pt = palloc_get_page(0);
+        if (pt == NULL)
+            return false;
+    }
+    reserve_push(pt);
+    *pde = pde_create_large(kpage, writable, true);
+    invalidate_pagedir(pd);
+    return true;
+}
+
+/* If the user virtual address VADDR lies in a 4 MB page in PD,
+   replaces it by a page table mapping the same memory with 4 kB
+   pages that inherit the large page's flags, so that its pages
+   can be unmapped, protected or cleaned one at a time.  The page
+   table is the one pagedir_set_large_page() set aside, so this
+   never fails. */
+static void
+split_large_page(uint32_t *pd, const void *vaddr)
+{
+    uint32_t *pde = pd + pd_no(vaddr);
+    uint32_t *pt;
+    uint32_t flags;
+    uint8_t *page;
+    size_t i;
+
+    if ((*pde & PTE_PS) == 0)
+        return;
+    ASSERT(is_user_vaddr(vaddr));
+
+    pt = reserve_pop();
+    page = pde_get_large_page(*pde);
+    flags = *pde & PTE_FLAGS & ~PTE_PS;
+    for (i = 0; i < PGSIZE / sizeof *pt; i++)
+        pt[i] = vtop(page + i * PGSIZE) | flags;
+    *pde = pde_create(pt);
+    invalidate_pagedir(pd);
+}
+
+/* Sets page table PT aside in the reserve. */
+static void
+reserve_push(uint32_t *pt)
+{
+    enum intr_level old_level = intr_disable();
+    *(uint32_t **)pt = pt_reserve;
+    pt_reserve = pt;
+    intr_set_level(old_level);
+}
+
+/* Takes a page table from the reserve, which must hold one for
+   each 4 MB page still mapped. */
+static uint32_t *
+reserve_pop(void)
+{
+    enum intr_level old_level = intr_disable();
+    uint32_t *pt = pt_reserve;
+
+    ASSERT(pt != NULL);
+    pt_reserve = *(uint32_t **)pt;
+    intr_set_level(old_level);
+    return pt;
+}
+
 /* Loads page directory PD into the CPU's page directory base
    register. */
 void pagedir_activate(uint32_t *pd)
@@ -255,5 +470,30 @@ invalidate_pagedir(uint32_t *pd)
         /* Re-activating PD clears the TLB.  See [IA32-v3a] 3.12
          "Translation Lookaside Buffers (TLBs)". */
         pagedir_activate(pd);
+        flush_cnt++;
     }
 }
+
+/* Invalidates the TLB entry for the page holding VADDR if PD is
+   the active page directory, leaving the rest of the TLB alone.
+   For an address in a 4 MB page this drops the whole large page's
+   entry.  See [IA32-v2a] "INVLPG--Invalidate TLB Entry". */
+static void
+invalidate_page(uint32_t *pd, const void *vaddr)
+{
+    if (active_pd() == pd)
+    {
+        asm volatile("invlpg (%0)"
+                     :
+                     : "r"(vaddr)
+                     : "memory");
+        invlpg_cnt++;
+    }
+}
+
+/* Prints TLB invalidation statistics. */
+void pagedir_print_stats(void)
+{
+    printf("Pagedir: %lld TLB flushes, %lld single pages invalidated\n",
+           flush_cnt, invlpg_cnt);
+}
@@ -2,17 +2,40 @@
 #define USERPROG_PAGEDIR_H
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
+/* Most pages whose TLB entries a batch invalidates one at a
+   time.  Past that, reloading CR3 to flush the whole TLB once is
+   cheaper. */
+#define PAGEDIR_BATCH 32
+
+/* Pages unmapped from one page directory whose TLB entries have
+   not been invalidated yet.  Unmapping a run of pages through a
+   batch costs one flush for the run instead of one per page. */
+struct pagedir_batch
+{
+    uint32_t *pd;                       /* Page directory. */
+    size_t cnt;                         /* Pages unmapped so far. */
+    const void *pages[PAGEDIR_BATCH];   /* The first PAGEDIR_BATCH. */
+};
+
 uint32_t *pagedir_create(void);
 void pagedir_destroy(uint32_t *pd);
 bool pagedir_set_page(uint32_t *pd, void *upage, void *kpage, bool rw);
+bool pagedir_set_large_page(uint32_t *pd, void *upage, void *kpage, bool rw);
 void *pagedir_get_page(uint32_t *pd, const void *upage);
 void pagedir_clear_page(uint32_t *pd, void *upage);
+void pagedir_clear_range(uint32_t *pd, void *start, void *end);
+void pagedir_batch_init(struct pagedir_batch *, uint32_t *pd);
+void pagedir_batch_clear(struct pagedir_batch *, void *upage);
+void pagedir_batch_flush(struct pagedir_batch *);
+void pagedir_set_writable(uint32_t *pd, const void *upage, bool writable);
 bool pagedir_is_dirty(uint32_t *pd, const void *upage);
 void pagedir_set_dirty(uint32_t *pd, const void *upage, bool dirty);
 bool pagedir_is_accessed(uint32_t *pd, const void *upage);
 void pagedir_set_accessed(uint32_t *pd, const void *upage, bool accessed);
 void pagedir_activate(uint32_t *pd);
+void pagedir_print_stats(void);
 
 #endif /* userprog/pagedir.h */
@@ -16,17 +16,22 @@
 #include "threads/flags.h"
 #include "threads/init.h"
 #include "threads/interrupt.h"
+#include "threads/malloc.h"
 #include "threads/palloc.h"
 #include "threads/thread.h"
 #include "threads/vaddr.h"
 #include "vm/page.h"
+#include "vm/rss.h"
+#include "vm/shm.h"
+#include "vm/vma.h"
 
 static thread_func start_process NO_RETURN;
+static thread_func start_fork NO_RETURN;
+static bool duplicate_process(struct thread *parent);
 static bool load(const char *cmdline, void (**eip)(void), void **esp);
 
 static void parse_line(const char *line, int *argc, char **argv);
 static void push_arguments(int argc, char **argv, void **esp);
-static void unmap_all();
 
 /* Starts a new thread running a user program loaded from
    FILENAME.  The new thread may be scheduled (and may even exit)
@@ -60,6 +65,8 @@ tid_t process_execute(const char *file_name)
     pcb->is_exited = false;
     sema_init(&pcb->exit_sema, 0);
     pcb->exit_status = -1;
+    memset(&pcb->vmstat, 0, sizeof pcb->vmstat);
+    rss_init_process(pcb, thread_get_pcb());
 
     /* Create a new thread to execute FILE_NAME. */
     thread_name = strtok_r(fn_copy2, " ", &save_ptr);
@@ -67,15 +74,22 @@ tid_t process_execute(const char *file_name)
     if (tid == TID_ERROR)
     {
         palloc_free_page(fn_copy1);
+        rss_exit(pcb);
         palloc_free_page(pcb);
         goto done;
     }
 
     /* Wait until child process's program is loaded. If it
-     successfully load its program, push it into children list. */
+     successfully load its program, push it into children list.
+     Otherwise wait for it to finish with PCB, and free it. */
     sema_down(&pcb->load_sema);
     if (pcb->pid != PID_ERROR)
         list_push_back(thread_get_children(), &pcb->childelem);
+    else
+    {
+        sema_down(&pcb->exit_sema);
+        palloc_free_page(pcb);
+    }
 
 done:
     palloc_free_page(fn_copy2);
@@ -113,10 +127,11 @@ start_process(void *pcb_)
     if (success)
         push_arguments(argc, argv, &if_.esp);
 
-    /* If load failed, quit. */
+    /* If load failed, quit quietly: the process never ran, and
+     exec() reports the failure to the parent. */
     palloc_free_page(file_name);
     if (!success)
-        syscall_exit(-1);
+        thread_exit();
 
     /* Start the user process by simulating a return from an
      interrupt, implemented by intr_exit (in
@@ -131,6 +146,166 @@ start_process(void *pcb_)
     NOT_REACHED();
 }
 
+/* Arguments handed from process_fork() to start_fork(). */
+struct fork_info
+{
+    struct process *pcb;   /* Child's process control block. */
+    struct thread *parent; /* Forking thread. */
+    struct intr_frame if_; /* Parent's user context at fork(). */
+};
+
+/* Starts a new process that is a copy of the current one, which
+   entered the kernel with interrupt frame F.  The child shares
+   the parent's frames copy-on-write and returns 0 from fork().
+   Returns the child's pid, or PID_ERROR if it could not be
+   created. */
+pid_t process_fork(const struct intr_frame *f)
+{
+    struct fork_info info;
+    struct process *pcb;
+    tid_t tid;
+
+    /* Create a process control block for the new process. */
+    pcb = palloc_get_page(0);
+    if (!pcb)
+        return PID_ERROR;
+    pcb->file_name = NULL;
+    pcb->parent = thread_current();
+    pcb->is_loaded = false;
+    sema_init(&pcb->load_sema, 0);
+    pcb->is_exited = false;
+    sema_init(&pcb->exit_sema, 0);
+    pcb->exit_status = -1;
+    memset(&pcb->vmstat, 0, sizeof pcb->vmstat);
+    rss_init_process(pcb, thread_get_pcb());
+
+    /* INFO lives on our stack, so stay blocked until the child
+     has copied everything it needs. */
+    info.pcb = pcb;
+    info.parent = thread_current();
+    info.if_ = *f;
+    tid = thread_create(thread_name(), PRI_DEFAULT, start_fork, &info);
+    if (tid == TID_ERROR)
+    {
+        rss_exit(pcb);
+        palloc_free_page(pcb);
+        return PID_ERROR;
+    }
+
+    /* A child that failed to duplicate us never ran; wait for it
+     to free what it copied, then free PCB ourselves. */
+    sema_down(&pcb->load_sema);
+    if (pcb->pid == PID_ERROR)
+    {
+        sema_down(&pcb->exit_sema);
+        palloc_free_page(pcb);
+        return PID_ERROR;
+    }
+    list_push_back(thread_get_children(), &pcb->childelem);
+
+    return tid;
+}
+
+/* A thread function that duplicates the forking process and
+   returns to user mode where it called fork(). */
+static void
+start_fork(void *info_)
+{
+    struct fork_info *info = info_;
+    struct process *pcb = info->pcb;
+    struct intr_frame if_ = info->if_;
+    bool success;
+
+    thread_set_pcb(pcb);
+    success = pcb->is_loaded = duplicate_process(info->parent);
+    pcb->pid = success ? thread_tid() : PID_ERROR;
+    sema_up(&pcb->load_sema);
+
+    /* Free whatever was copied without printing an exit line:
+     fork() returns PID_ERROR to the parent instead. */
+    if (!success)
+        thread_exit();
+
+    /* fork() returns 0 in the child. */
+    if_.eax = 0;
+    asm volatile("movl %0, %%esp; jmp intr_exit"
+                 :
+                 : "g"(&if_)
+                 : "memory");
+    NOT_REACHED();
+}
+
+/* Copies PARENT's address space, file descriptors and memory
+   mappings into the current thread.  Files are reopened, so the
+   child gets its own file positions. */
+static bool
+duplicate_process(struct thread *parent)
+{
+    struct thread *t = thread_current();
+    struct lock *filesys_lock = syscall_get_filesys_lock();
+    struct list_elem *e;
+    bool success = false;
+
+    t->pagedir = pagedir_create();
+    if (t->pagedir == NULL)
+        return false;
+    process_activate();
+
+    t->pages = page_table_create();
+    if (t->pages == NULL)
+        return false;
+    if (!page_fork(parent))
+        return false;
+
+    lock_acquire(filesys_lock);
+
+    t->running_file = file_reopen(parent->running_file);
+    if (t->running_file == NULL)
+        goto done;
+    file_deny_write(t->running_file);
+    page_rebind_file(parent->running_file, t->running_file);
+
+    /* Set first, so that process_exit() closes the descriptors
+     copied so far if copying fails. */
+    t->next_fd = parent->next_fd;
+    for (e = list_begin(&parent->fdt); e != list_end(&parent->fdt); e = list_next(e))
+    {
+        struct file_descriptor_entry *fde = list_entry(e, struct file_descriptor_entry, fdtelem);
+        struct file_descriptor_entry *new_fde = palloc_get_page(0);
+
+        if (!new_fde)
+            goto done;
+        new_fde->shm = fde->shm;
+        if (fde->shm != NULL)
+        {
+            new_fde->file = NULL;
+            shm_dup(fde->shm);
+        }
+        else
+        {
+            new_fde->file = file_reopen(fde->file);
+            if (!new_fde->file)
+            {
+                palloc_free_page(new_fde);
+                goto done;
+            }
+            file_seek(new_fde->file, file_tell(fde->file));
+        }
+        new_fde->fd = fde->fd;
+        list_push_back(&t->fdt, &new_fde->fdtelem);
+    }
+
+    if (!vma_fork(parent))
+        goto done;
+    t->number_mapped = parent->number_mapped;
+
+    success = true;
+
+done:
+    lock_release(filesys_lock);
+    return success;
+}
+
 /* Waits for thread TID to die and returns its exit status.  If
    it was terminated by the kernel (i.e. killed due to an
    exception), returns -1.  If TID is invalid or if it was not a
@@ -170,7 +345,11 @@ void process_exit(void)
      close all of its files, and notify its parent of its termination.
      Finally, free its page if it is orphaned. */
 
-    unmap_all();
+    /* Free the pages before the parent can see the exit: they
+     are charged to PCB, which it may free then. */
+    vma_exit();
+    page_exit();
+    rss_exit(pcb);
 
     pcb->is_exited = true;
     for (e = list_begin(children); e != list_end(children); e = list_next(e))
@@ -186,9 +365,6 @@ void process_exit(void)
     file_close(thread_get_running_file());
     lock_release(filesys_lock);
 
-    /* Destory page table */
-    page_exit();
-
     /* Destroy the current process's page directory and switch back
      to the kernel-only page directory. */
     pd = thread_get_pagedir();
@@ -207,19 +383,6 @@ void process_exit(void)
     }
 }
 
-static void
-unmap_all()
-{
-    struct list_elem *e;
-    struct file_mapping *m;
-    for (e = list_begin (&thread_current()->file_mapping_list); e != list_end (&thread_current()->file_mapping_list);)
-    {
-        struct file_mapping *mmap = list_entry (e, struct file_mapping, elem);
-        e = list_next (e);
-        unmap (mmap);
-    }
-}
-
 /* Sets up the CPU for running user code in the current
    thread.
    This function is called on every context switch. */
@@ -352,6 +515,17 @@ static bool load_segment(struct file *file, off_t ofs, uint8_t *upage,
                          uint32_t read_bytes, uint32_t zero_bytes,
                          bool writable);
 
+/* Most segments load() maps at exec time. */
+#define EAGER_SEGMENTS_MAX 4
+
+/* A segment load() maps at exec time: the pages from UPAGE that
+   hold file data. */
+struct eager_segment
+{
+    uint8_t *upage;
+    size_t page_cnt;
+};
+
 /* Loads an ELF executable from FILE_NAME into the current thread.
    Stores the executable's entry point into *EIP
    and its initial stack pointer into *ESP.
@@ -362,6 +536,8 @@ bool load(const char *file_name, void (**eip)(void), void **esp)
     struct Elf32_Ehdr ehdr;
     struct file *file = NULL;
     struct lock *filesys_lock = syscall_get_filesys_lock();
+    struct eager_segment eager[EAGER_SEGMENTS_MAX];
+    size_t eager_cnt = 0;
     off_t file_ofs;
     bool success = false;
     int i;
@@ -373,10 +549,9 @@ bool load(const char *file_name, void (**eip)(void), void **esp)
     
     process_activate();
 
-    t->pages = malloc (sizeof *t->pages);
+    t->pages = page_table_create();
     if(t->pages == NULL)
         goto done;
-    hash_init (t->pages, page_hash_func, page_less_func, NULL);
 
     /* Open executable file. */
     lock_acquire(filesys_lock);
@@ -445,6 +620,17 @@ bool load(const char *file_name, void (**eip)(void), void **esp)
                 if (!load_segment(file, file_page, (void *)mem_page,
                                   read_bytes, zero_bytes, writable))
                     goto done;
+
+                /* Code, and data segments up to page_eager_load
+                 pages, are read in at once rather than a page per
+                 fault. */
+                if (page_eager_load > 0 && read_bytes > 0 && eager_cnt < EAGER_SEGMENTS_MAX
+                    && (!writable || (read_bytes + zero_bytes) / PGSIZE <= page_eager_load))
+                {
+                    eager[eager_cnt].upage = (uint8_t *)mem_page;
+                    eager[eager_cnt].page_cnt = DIV_ROUND_UP(read_bytes, PGSIZE);
+                    eager_cnt++;
+                }
             }
             else
                 goto done;
@@ -452,10 +638,6 @@ bool load(const char *file_name, void (**eip)(void), void **esp)
         }
     }
 
-    /* Set up stack. */
-    if (!setup_stack(esp))
-        goto done;
-
     /* Start address. */
     *eip = (void (*)(void))ehdr.e_entry;
 
@@ -469,7 +651,14 @@ bool load(const char *file_name, void (**eip)(void), void **esp)
 done:
     /* We arrive here whether the load is successful or not. */
     lock_release(filesys_lock);
-    return success;
+
+    /* Map segments eagerly and set up stack outside
+       filesys_lock, which reading pages and evicting a frame for
+       the stack may need. */
+    if (success)
+        for (i = 0; i < (int)eager_cnt; i++)
+            page_preload(eager[i].upage, eager[i].page_cnt);
+    return success && setup_stack(esp);
 }
 
 /* load() helpers. */
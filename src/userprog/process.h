@@ -2,6 +2,7 @@
 #define USERPROG_PROCESS_H
 
 #include "lib/user/syscall.h"
+#include "threads/interrupt.h"
 #include "threads/synch.h"
 #include "threads/thread.h"
 
@@ -22,17 +23,31 @@ struct process
     bool is_exited;             /* Whether process is exited. */
     struct semaphore exit_sema; /* Semaphore for waiting until exit. */
     int exit_status;            /* Exit status. */
+
+    /* Owned by vm/rss.c and vm/frame.c. */
+    size_t rss;                 /* Resident pages. */
+    size_t rss_soft;            /* Soft limit in pages, 0 if none. */
+    size_t rss_hard;            /* Hard limit in pages, 0 if none. */
+    struct mem_group *group;    /* Memory group, or NULL. */
+    void *rss_hand;             /* Next page of the local clock. */
+
+    /* Owned by vm/vmstat.c. */
+    struct vmstat vmstat;       /* VM statistics of this process. */
 };
 
 /* A file descriptor entry. */
+struct shm;
+
 struct file_descriptor_entry
 {
     int fd;                   /* File descriptor. */
-    struct file *file;        /* File. */
+    struct file *file;        /* File, or NULL for shared memory. */
+    struct shm *shm;          /* Shared memory segment, if file is NULL. */
     struct list_elem fdtelem; /* List element for file descriptor table. */
 };
 
 tid_t process_execute(const char *);
+pid_t process_fork(const struct intr_frame *);
 int process_wait(tid_t);
 void process_exit(void);
 void process_activate(void);
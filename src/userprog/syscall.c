@@ -4,24 +4,38 @@
 #include <bitmap.h>
 #include "devices/input.h"
 #include "devices/shutdown.h"
+#include "filesys/directory.h"
 #include "filesys/file.h"
 #include "filesys/filesys.h"
 #include "lib/kernel/stdio.h"
 #include "threads/interrupt.h"
+#include "threads/malloc.h"
 #include "threads/palloc.h"
 #include "threads/synch.h"
 #include "threads/thread.h"
 #include "threads/vaddr.h"
 #include "userprog/pagedir.h"
 #include "userprog/process.h"
+#include "userprog/uaccess.h"
 #include "vm/page.h"
+#include "vm/faultstat.h"
 #include "vm/frame.h"
+#include "vm/rss.h"
+#include "vm/shm.h"
+#include "vm/vma.h"
+#include "vm/vmstat.h"
+#include "vm/wss.h"
 
 struct lock filesys_lock;
 
+/* Largest piece of a user buffer pinned at once by read() and
+   write(), so that a large transfer cannot pin most of memory. */
+#define IO_CHUNK (16 * PGSIZE)
+
 static void syscall_handler(struct intr_frame *);
 
-static void check_vaddr(const void *);
+static void get_args(const void *, uintptr_t *, size_t);
+static bool get_file_name(char[NAME_MAX + 1], const char *);
 
 static void syscall_halt(void);
 static pid_t syscall_exec(const char *);
@@ -36,11 +50,18 @@ static void syscall_seek(int, unsigned);
 static unsigned syscall_tell(int);
 static mapid_t syscall_mmap (int, void *);
 static void syscall_munmap (mapid_t);
-
-
-static void clear_previous_pages(void* addr, off_t ofs);
-static mapid_t register_new_mmap(struct file* file, void* base, int page_count);
-static struct file_mapping* get_file_mapping_by_mapid(mapid_t id);
+static pid_t syscall_fork(struct intr_frame *);
+static void *syscall_mmap2(const struct mmap_args *);
+static bool syscall_munmap2(void *, unsigned);
+static bool syscall_mprotect(void *, unsigned, int);
+static bool syscall_madvise(void *, unsigned, int);
+static bool syscall_msync(void *, unsigned, int);
+static bool syscall_setrss(int, unsigned, unsigned);
+static bool syscall_vmstat(int, struct vmstat *);
+static bool syscall_wss(struct wss *);
+static bool syscall_faultstat(struct faultstat *);
+static int syscall_shm_open(const char *, int, unsigned);
+static bool syscall_shm_unlink(const char *);
 
 /* Registers the system call interrupt handler. */
 void syscall_init(void)
@@ -49,6 +70,16 @@ void syscall_init(void)
     lock_init(&filesys_lock);
 }
 
+/* Copies the CNT arguments above the system call number at ESP
+   into ARGS.  If they cannot be read, terminates the current
+   process. */
+static void
+get_args(const void *esp, uintptr_t *args, size_t cnt)
+{
+    if (!copy_from_user(args, esp + sizeof(uintptr_t), cnt * sizeof *args))
+        syscall_exit(-1);
+}
+
 /* Pops the system call number and handles system call
    according to it. */
 static void
@@ -56,10 +87,11 @@ syscall_handler(struct intr_frame *f)
 {
     void *esp = f->esp;
     int syscall_num;
+    uintptr_t args[3];
 
-    check_vaddr(esp);
-    check_vaddr(esp + sizeof(uintptr_t) - 1);
-    syscall_num = *(int *)esp;
+    thread_current()->user_esp = esp;
+    if (!copy_from_user(&syscall_num, esp, sizeof syscall_num))
+        syscall_exit(-1);
 
     switch (syscall_num)
     {
@@ -70,170 +102,163 @@ syscall_handler(struct intr_frame *f)
     }
     case SYS_EXIT:
     {
-        int status;
-
-        check_vaddr(esp + sizeof(uintptr_t));
-        check_vaddr(esp + 2 * sizeof(uintptr_t) - 1);
-        status = *(int *)(esp + sizeof(uintptr_t));
-
-        syscall_exit(status);
+        get_args(esp, args, 1);
+        syscall_exit((int)args[0]);
         NOT_REACHED();
     }
     case SYS_EXEC:
     {
-        char *cmd_line;
-
-        check_vaddr(esp + sizeof(uintptr_t));
-        check_vaddr(esp + 2 * sizeof(uintptr_t) - 1);
-        cmd_line = *(char **)(esp + sizeof(uintptr_t));
-
-        f->eax = (uint32_t)syscall_exec(cmd_line);
+        get_args(esp, args, 1);
+        f->eax = (uint32_t)syscall_exec((const char *)args[0]);
         break;
     }
     case SYS_WAIT:
     {
-        pid_t pid;
-
-        check_vaddr(esp + sizeof(uintptr_t));
-        check_vaddr(esp + 2 * sizeof(uintptr_t) - 1);
-        pid = *(pid_t *)(esp + sizeof(uintptr_t));
-
-        f->eax = (uint32_t)syscall_wait(pid);
+        get_args(esp, args, 1);
+        f->eax = (uint32_t)syscall_wait((pid_t)args[0]);
         break;
     }
     case SYS_CREATE:
     {
-        char *file;
-        unsigned initial_size;
-
-        check_vaddr(esp + sizeof(uintptr_t));
-        check_vaddr(esp + 3 * sizeof(uintptr_t) - 1);
-        file = *(char **)(esp + sizeof(uintptr_t));
-        initial_size = *(unsigned *)(esp + 2 * sizeof(uintptr_t));
-
-        f->eax = (uint32_t)syscall_create(file, initial_size);
+        get_args(esp, args, 2);
+        f->eax = (uint32_t)syscall_create((const char *)args[0], (unsigned)args[1]);
         break;
     }
     case SYS_REMOVE:
     {
-        char *file;
-
-        check_vaddr(esp + sizeof(uintptr_t));
-        check_vaddr(esp + 2 * sizeof(uintptr_t) - 1);
-        file = *(char **)(esp + sizeof(uintptr_t));
-
-        f->eax = (uint32_t)syscall_remove(file);
+        get_args(esp, args, 1);
+        f->eax = (uint32_t)syscall_remove((const char *)args[0]);
         break;
     }
     case SYS_OPEN:
     {
-        char *file;
-
-        check_vaddr(esp + sizeof(uintptr_t));
-        check_vaddr(esp + 2 * sizeof(uintptr_t) - 1);
-        file = *(char **)(esp + sizeof(uintptr_t));
-
-        f->eax = (uint32_t)syscall_open(file);
+        get_args(esp, args, 1);
+        f->eax = (uint32_t)syscall_open((const char *)args[0]);
         break;
     }
     case SYS_FILESIZE:
     {
-        int fd;
-
-        check_vaddr(esp + sizeof(uintptr_t));
-        check_vaddr(esp + 2 * sizeof(uintptr_t) - 1);
-        fd = *(int *)(esp + sizeof(uintptr_t));
-
-        f->eax = (uint32_t)syscall_filesize(fd);
+        get_args(esp, args, 1);
+        f->eax = (uint32_t)syscall_filesize((int)args[0]);
         break;
     }
     case SYS_READ:
     {
-        int fd;
-        void *buffer;
-        unsigned size;
-
-        check_vaddr(esp + sizeof(uintptr_t));
-        check_vaddr(esp + 4 * sizeof(uintptr_t) - 1);
-        fd = *(int *)(esp + sizeof(uintptr_t));
-        buffer = *(void **)(esp + 2 * sizeof(uintptr_t));
-        size = *(unsigned *)(esp + 3 * sizeof(uintptr_t));
-
-        f->eax = (uint32_t)syscall_read(fd, buffer, size);
+        get_args(esp, args, 3);
+        f->eax = (uint32_t)syscall_read((int)args[0], (void *)args[1], (unsigned)args[2]);
         break;
     }
     case SYS_WRITE:
     {
-        int fd;
-        void *buffer;
-        unsigned size;
-
-        check_vaddr(esp + sizeof(uintptr_t));
-        check_vaddr(esp + 4 * sizeof(uintptr_t) - 1);
-        fd = *(int *)(esp + sizeof(uintptr_t));
-        buffer = *(void **)(esp + 2 * sizeof(uintptr_t));
-        size = *(unsigned *)(esp + 3 * sizeof(uintptr_t));
-
-        f->eax = (uint32_t)syscall_write(fd, buffer, size);
+        get_args(esp, args, 3);
+        f->eax = (uint32_t)syscall_write((int)args[0], (const void *)args[1], (unsigned)args[2]);
         break;
     }
     case SYS_SEEK:
     {
-        int fd;
-        unsigned position;
-
-        check_vaddr(esp + sizeof(uintptr_t));
-        check_vaddr(esp + 3 * sizeof(uintptr_t) - 1);
-        fd = *(int *)(esp + sizeof(uintptr_t));
-        position = *(unsigned *)(esp + 2 * sizeof(uintptr_t));
-
-        syscall_seek(fd, position);
+        get_args(esp, args, 2);
+        syscall_seek((int)args[0], (unsigned)args[1]);
         break;
     }
     case SYS_TELL:
     {
-        int fd;
-
-        check_vaddr(esp + sizeof(uintptr_t));
-        check_vaddr(esp + 2 * sizeof(uintptr_t) - 1);
-        fd = *(int *)(esp + sizeof(uintptr_t));
-
-        f->eax = (uint32_t)syscall_tell(fd);
+        get_args(esp, args, 1);
+        f->eax = (uint32_t)syscall_tell((int)args[0]);
         break;
     }
     case SYS_CLOSE:
     {
-        int fd;
-
-        check_vaddr(esp + sizeof(uintptr_t));
-        check_vaddr(esp + 2 * sizeof(uintptr_t) - 1);
-        fd = *(int *)(esp + sizeof(uintptr_t));
-
-        syscall_close(fd);
+        get_args(esp, args, 1);
+        syscall_close((int)args[0]);
         break;
     }
     case SYS_MMAP:
     {
-        int fd;
-        void* addr;
-
-        check_vaddr(esp + sizeof(uintptr_t));
-        check_vaddr(esp + 3 * sizeof(uintptr_t) - 1);
-        fd = *(int *)(esp + sizeof(uintptr_t));
-        addr = *(void **)(esp + 2 * sizeof(uintptr_t));
-
-        f->eax = syscall_mmap (fd, addr);
+        get_args(esp, args, 2);
+        f->eax = syscall_mmap ((int)args[0], (void *)args[1]);
         break;
     }
     case SYS_MUNMAP:
     {
-        mapid_t mapping;
-
-        check_vaddr(esp + sizeof(uintptr_t));
-        check_vaddr(esp + 2 * sizeof(uintptr_t) - 1);
-        mapping = *(mapid_t *)(esp + sizeof(uintptr_t));
-
-        syscall_munmap (mapping);
+        get_args(esp, args, 1);
+        syscall_munmap ((mapid_t)args[0]);
+        break;
+    }
+    case SYS_FORK:
+    {
+        f->eax = (uint32_t)syscall_fork(f);
+        break;
+    }
+    case SYS_MMAP2:
+    {
+        get_args(esp, args, 1);
+        f->eax = (uint32_t)syscall_mmap2((const struct mmap_args *)args[0]);
+        break;
+    }
+    case SYS_MUNMAP2:
+    {
+        get_args(esp, args, 2);
+        f->eax = (uint32_t)syscall_munmap2((void *)args[0], (unsigned)args[1]);
+        break;
+    }
+    case SYS_MPROTECT:
+    {
+        get_args(esp, args, 3);
+        f->eax = (uint32_t)syscall_mprotect((void *)args[0], (unsigned)args[1], (int)args[2]);
+        break;
+    }
+    case SYS_MADVISE:
+    {
+        get_args(esp, args, 3);
+        f->eax = (uint32_t)syscall_madvise((void *)args[0], (unsigned)args[1], (int)args[2]);
+        break;
+    }
+    case SYS_MSYNC:
+    {
+        get_args(esp, args, 3);
+        f->eax = (uint32_t)syscall_msync((void *)args[0], (unsigned)args[1], (int)args[2]);
+        break;
+    }
+    case SYS_SETRSS:
+    {
+        get_args(esp, args, 3);
+        f->eax = (uint32_t)syscall_setrss((int)args[0], (unsigned)args[1], (unsigned)args[2]);
+        break;
+    }
+    case SYS_GETRSS:
+    {
+        f->eax = (uint32_t)thread_get_pcb()->rss;
+        break;
+    }
+    case SYS_VMSTAT:
+    {
+        get_args(esp, args, 2);
+        f->eax = (uint32_t)syscall_vmstat((int)args[0], (struct vmstat *)args[1]);
+        break;
+    }
+    case SYS_WSS:
+    {
+        get_args(esp, args, 1);
+        f->eax = (uint32_t)syscall_wss((struct wss *)args[0]);
+        break;
+    }
+    case SYS_FAULTSTAT:
+    {
+        get_args(esp, args, 1);
+        f->eax = (uint32_t)syscall_faultstat((struct faultstat *)args[0]);
+        break;
+    }
+    case SYS_SHM_OPEN:
+    {
+        get_args(esp, args, 3);
+        f->eax = (uint32_t)syscall_shm_open((const char *)args[0], (int)args[1],
+                                            (unsigned)args[2]);
+        break;
+    }
+    case SYS_SHM_UNLINK:
+    {
+        get_args(esp, args, 1);
+        f->eax = (uint32_t)syscall_shm_unlink((const char *)args[0]);
         break;
     }
     default:
@@ -241,13 +266,16 @@ syscall_handler(struct intr_frame *f)
     }
 }
 
-/* Checks user-provided virtual address. If it is
-   invalid, terminates the current process. */
-static void
-check_vaddr(const void *vaddr)
+/* Copies the file name at user address UNAME into NAME.
+   Terminates the current process if UNAME is bad.  Returns false
+   if the name is longer than any file name can be. */
+static bool
+get_file_name(char name[NAME_MAX + 1], const char *uname)
 {
-    if (!vaddr || !is_user_vaddr(vaddr) || !page_find_by_upage(pg_round_down(vaddr)))
+    int len = strncpy_from_user(name, uname, NAME_MAX + 1);
+    if (len < 0)
         syscall_exit(-1);
+    return len <= NAME_MAX;
 }
 
 struct lock *syscall_get_filesys_lock(void)
@@ -277,13 +305,19 @@ static pid_t syscall_exec(const char *cmd_line)
 {
     pid_t pid;
     struct process *child;
-    int i;
+    char *kcmd_line;
 
-    check_vaddr(cmd_line);
-    for (i = 0; *(cmd_line + i); i++)
-        check_vaddr(cmd_line + i + 1);
+    kcmd_line = palloc_get_page(0);
+    if (!kcmd_line)
+        return PID_ERROR;
+    if (strncpy_from_user(kcmd_line, cmd_line, PGSIZE) < 0)
+    {
+        palloc_free_page(kcmd_line);
+        syscall_exit(-1);
+    }
 
-    pid = process_execute(cmd_line);
+    pid = process_execute(kcmd_line);
+    palloc_free_page(kcmd_line);
     child = process_get_child(pid);
 
     if (!child || !child->is_loaded)
@@ -292,6 +326,12 @@ static pid_t syscall_exec(const char *cmd_line)
     return pid;
 }
 
+/* Handles fork() system call. */
+static pid_t syscall_fork(struct intr_frame *f)
+{
+    return process_fork(f);
+}
+
 /* Handles wait() system call. */
 static int syscall_wait(pid_t pid)
 {
@@ -302,14 +342,13 @@ static int syscall_wait(pid_t pid)
 static bool syscall_create(const char *file, unsigned initial_size)
 {
     bool success;
-    int i;
+    char name[NAME_MAX + 1];
 
-    check_vaddr(file);
-    for (i = 0; *(file + i); i++)
-        check_vaddr(file + i + 1);
+    if (!get_file_name(name, file))
+        return false;
 
     lock_acquire(&filesys_lock);
-    success = filesys_create(file, (off_t)initial_size);
+    success = filesys_create(name, (off_t)initial_size);
     lock_release(&filesys_lock);
 
     return success;
@@ -319,14 +358,13 @@ static bool syscall_create(const char *file, unsigned initial_size)
 static bool syscall_remove(const char *file)
 {
     bool success;
-    int i;
+    char name[NAME_MAX + 1];
 
-    check_vaddr(file);
-    for (i = 0; *(file + i); i++)
-        check_vaddr(file + i + 1);
+    if (!get_file_name(name, file))
+        return false;
 
     lock_acquire(&filesys_lock);
-    success = filesys_remove(file);
+    success = filesys_remove(name);
     lock_release(&filesys_lock);
 
     return success;
@@ -337,11 +375,10 @@ static int syscall_open(const char *file)
 {
     struct file_descriptor_entry *fde;
     struct file *new_file;
-    int i;
+    char name[NAME_MAX + 1];
 
-    check_vaddr(file);
-    for (i = 0; *(file + i); i++)
-        check_vaddr(file + i + 1);
+    if (!get_file_name(name, file))
+        return -1;
 
     fde = palloc_get_page(0);
     if (!fde)
@@ -349,7 +386,7 @@ static int syscall_open(const char *file)
 
     lock_acquire(&filesys_lock);
 
-    new_file = filesys_open(file);
+    new_file = filesys_open(name);
     if (!new_file)
     {
         palloc_free_page(fde);
@@ -360,6 +397,7 @@ static int syscall_open(const char *file)
 
     fde->fd = thread_get_next_fd();
     fde->file = new_file;
+    fde->shm = NULL;
     list_push_back(thread_get_fdt(), &fde->fdtelem);
 
     lock_release(&filesys_lock);
@@ -375,6 +413,8 @@ static int syscall_filesize(int fd)
 
     if (!fde)
         return -1;
+    if (fde->shm != NULL)
+        return fde->shm->page_cnt * PGSIZE;
 
     lock_acquire(&filesys_lock);
     filesize = file_length(fde->file);
@@ -387,9 +427,10 @@ static int syscall_filesize(int fd)
 static int syscall_read(int fd, void *buffer, unsigned size)
 {
     struct file_descriptor_entry *fde;
-    int bytes_read, i;
-    for (i = 0; i < size; i++)
-        check_vaddr(buffer + i);
+    int bytes_read;
+
+    if (!check_user_range(buffer, size))
+        syscall_exit(-1);
 
     if (fd == 0)
     {
@@ -402,12 +443,31 @@ static int syscall_read(int fd, void *buffer, unsigned size)
     }
 
     fde = process_get_fde(fd);
-    if (!fde)
+    if (!fde || !fde->file)
         return -1;
 
-    lock_acquire(&filesys_lock);
-    bytes_read = (int)file_read(fde->file, buffer, (off_t)size);
-    lock_release(&filesys_lock);
+    /* The buffer is pinned rather than faulted in under
+       filesys_lock, which the fault path may need itself. */
+    bytes_read = 0;
+    while ((unsigned)bytes_read < size)
+    {
+        void *chunk = buffer + bytes_read;
+        unsigned chunk_size = size - bytes_read;
+        int cnt;
+
+        if (chunk_size > IO_CHUNK - pg_ofs(chunk))
+            chunk_size = IO_CHUNK - pg_ofs(chunk);
+        if (!page_pin_range(chunk, chunk_size, true))
+            syscall_exit(-1);
+        lock_acquire(&filesys_lock);
+        cnt = (int)file_read(fde->file, chunk, (off_t)chunk_size);
+        lock_release(&filesys_lock);
+        page_unpin_range(chunk, chunk_size);
+
+        bytes_read += cnt;
+        if ((unsigned)cnt < chunk_size)
+            break;
+    }
 
     return bytes_read;
 }
@@ -416,10 +476,10 @@ static int syscall_read(int fd, void *buffer, unsigned size)
 static int syscall_write(int fd, const void *buffer, unsigned size)
 {
     struct file_descriptor_entry *fde;
-    int bytes_written, i;
+    int bytes_written;
 
-    for (i = 0; i < size; i++)
-        check_vaddr(buffer + i);
+    if (!check_user_range(buffer, size))
+        syscall_exit(-1);
 
     if (fd == 1)
     {
@@ -429,12 +489,29 @@ static int syscall_write(int fd, const void *buffer, unsigned size)
     }
 
     fde = process_get_fde(fd);
-    if (!fde)
+    if (!fde || !fde->file)
         return -1;
 
-    lock_acquire(&filesys_lock);
-    bytes_written = (int)file_write(fde->file, buffer, (off_t)size);
-    lock_release(&filesys_lock);
+    bytes_written = 0;
+    while ((unsigned)bytes_written < size)
+    {
+        const void *chunk = buffer + bytes_written;
+        unsigned chunk_size = size - bytes_written;
+        int cnt;
+
+        if (chunk_size > IO_CHUNK - pg_ofs(chunk))
+            chunk_size = IO_CHUNK - pg_ofs(chunk);
+        if (!page_pin_range(chunk, chunk_size, false))
+            syscall_exit(-1);
+        lock_acquire(&filesys_lock);
+        cnt = (int)file_write(fde->file, chunk, (off_t)chunk_size);
+        lock_release(&filesys_lock);
+        page_unpin_range(chunk, chunk_size);
+
+        bytes_written += cnt;
+        if ((unsigned)cnt < chunk_size)
+            break;
+    }
 
     return bytes_written;
 }
@@ -444,7 +521,7 @@ static void syscall_seek(int fd, unsigned position)
 {
     struct file_descriptor_entry *fde = process_get_fde(fd);
 
-    if (!fde)
+    if (!fde || !fde->file)
         return;
 
     lock_acquire(&filesys_lock);
@@ -458,7 +535,7 @@ static unsigned syscall_tell(int fd)
     struct file_descriptor_entry *fde = process_get_fde(fd);
     unsigned pos;
 
-    if (!fde)
+    if (!fde || !fde->file)
         return -1;
 
     lock_acquire(&filesys_lock);
@@ -476,6 +553,14 @@ void syscall_close(int fd)
     if (!fde)
         return;
 
+    if (fde->shm != NULL)
+    {
+        list_remove(&fde->fdtelem);
+        shm_put(fde->shm);
+        palloc_free_page(fde);
+        return;
+    }
+
     lock_acquire(&filesys_lock);
     file_close(fde->file);
     list_remove(&fde->fdtelem);
@@ -483,123 +568,234 @@ void syscall_close(int fd)
     lock_release(&filesys_lock);
 }
 
+/* Handles mmap() system call: maps all of file FD, shared, at
+   ADDR. */
 static mapid_t
 syscall_mmap (int fd, void *addr)
 {
     struct file_descriptor_entry *fde = process_get_fde(fd);
+    struct thread *t = thread_current();
     off_t len;
-    struct file* file;
-    if(addr == NULL || !is_user_vaddr(addr) || pg_ofs(addr) != 0)
-    {
-        return -1;
-    }
-    
+
+    if (fde == NULL || fde->file == NULL || addr == NULL)
+        return MAP_FAILED;
+
     lock_acquire(&filesys_lock);
-    file = file_reopen(fde->file);
-    if(file == NULL)
-    {
-        lock_release(&filesys_lock);
-        return -1;
-    }
-    else
+    len = file_length(fde->file);
+    lock_release(&filesys_lock);
+
+    if (len == 0 || !vma_map(&addr, len, PROT_READ | PROT_WRITE, MAP_SHARED,
+                             fde->file, NULL, 0, t->number_mapped))
+        return MAP_FAILED;
+    return t->number_mapped++;
+}
+
+/* Handles munmap() system call. */
+static void
+syscall_munmap (mapid_t mapping)
+{
+    vma_unmap_id(mapping);
+}
+
+/* Handles mmap2() system call, whose arguments are at user
+   address UARGS.  Returns the address of the mapping, or NULL. */
+static void *
+syscall_mmap2(const struct mmap_args *uargs)
+{
+    struct file_descriptor_entry *fde = NULL;
+    struct mmap_args args;
+    struct shm *shm = NULL;
+    bool success;
+
+    if (!copy_from_user(&args, uargs, sizeof args))
+        syscall_exit(-1);
+
+    /* Exactly one of MAP_SHARED and MAP_PRIVATE. */
+    if ((args.prot & PROT_READ) == 0
+        || (args.prot & ~(PROT_READ | PROT_WRITE | PROT_EXEC)) != 0
+        || (args.flags & ~(MAP_SHARED | MAP_PRIVATE | MAP_ANONYMOUS)) != 0
+        || !(args.flags & MAP_SHARED) == !(args.flags & MAP_PRIVATE)
+        || pg_ofs(args.addr) != 0 || pg_ofs((void *)args.offset) != 0
+        || args.offset > INT32_MAX)
+        return NULL;
+    if (!(args.flags & MAP_ANONYMOUS) && (fde = process_get_fde(args.fd)) == NULL)
+        return NULL;
+
+    /* Shared anonymous memory is an unnamed segment of its own.
+       A named segment can only be mapped shared, and only up to
+       its end. */
+    if ((args.flags & (MAP_ANONYMOUS | MAP_SHARED)) == (MAP_ANONYMOUS | MAP_SHARED))
     {
-        len = file_length(file);
-        lock_release(&filesys_lock);
+        if (args.offset != 0 || (shm = shm_create(args.length)) == NULL)
+            return NULL;
     }
-    
-    off_t ofs=0;
-    int page_count = 0;
-    while(len > 0)
+    else if (fde != NULL && fde->shm != NULL)
     {
-        int read_bytes=len >= PGSIZE ? PGSIZE : len;
-        int zero_bytes=len < PGSIZE ? (PGSIZE - len) : 0;
-        if(!page_create_with_file(addr + ofs, file, ofs, read_bytes, zero_bytes, true, true))
-        {
-            clear_previous_pages(addr, ofs);
-            file_close(file);
-            return -1;
-        }
-        ofs+=read_bytes;
-        len-=read_bytes;
-        page_count++;
+        shm = fde->shm;
+        if (!(args.flags & MAP_SHARED)
+            || args.offset > shm->page_cnt * PGSIZE
+            || args.length > shm->page_cnt * PGSIZE - args.offset)
+            return NULL;
+        shm_dup(shm);
     }
 
-    return register_new_mmap(file, addr, page_count);
+    success = vma_map(&args.addr, args.length, args.prot, args.flags,
+                      fde != NULL ? fde->file : NULL, shm, args.offset, MAP_FAILED);
+    if (shm != NULL)
+        shm_put(shm);
+    return success ? args.addr : NULL;
 }
 
-static void
-syscall_munmap (mapid_t mapping)
+/* Handles munmap2() system call. */
+static bool
+syscall_munmap2(void *addr, unsigned length)
 {
-    struct file_mapping *m = get_file_mapping_by_mapid(mapping);
-    if(m == NULL) return;
-    unmap(m);
+    return vma_unmap(addr, length);
 }
 
-void
-mmap_file_write_at(struct file* file, void* addr, uint32_t read_bytes, off_t ofs)
+/* Handles mprotect() system call. */
+static bool
+syscall_mprotect(void *addr, unsigned length, int prot)
 {
-    ASSERT(file != NULL);
-    lock_acquire(&filesys_lock);
-    file_write_at(file, addr, read_bytes, ofs);
-    lock_release(&filesys_lock);
+    if ((prot & PROT_READ) == 0 || (prot & ~(PROT_READ | PROT_WRITE | PROT_EXEC)) != 0)
+        return false;
+    return vma_protect(addr, length, prot);
 }
 
-static mapid_t
-register_new_mmap(struct file* file, void* base, int page_count)
+/* Handles madvise() system call. */
+static bool
+syscall_madvise(void *addr, unsigned length, int advice)
+{
+    switch (advice)
+    {
+    case MADV_NORMAL:
+    case MADV_RANDOM:
+    case MADV_SEQUENTIAL:
+    case MADV_WILLNEED:
+    case MADV_DONTNEED:
+    case MADV_FREE:
+        return vma_advise(addr, length, advice);
+    default:
+        return false;
+    }
+}
+
+/* Handles msync() system call. */
+static bool
+syscall_msync(void *addr, unsigned length, int flags)
 {
-    struct file_mapping* m = malloc(sizeof(struct file_mapping));
-    m->file = file;
-    m->base = base;
-    m->page_count = page_count;
-    m->mapid = thread_current()->number_mapped++;
-    list_push_back(&thread_current()->file_mapping_list, &m->elem);
-    return m->mapid;
+    if ((flags & ~(MS_ASYNC | MS_INVALIDATE | MS_SYNC)) != 0
+        || (flags & (MS_ASYNC | MS_SYNC)) == (MS_ASYNC | MS_SYNC))
+        return false;
+    return vma_sync(addr, length, flags);
 }
 
-static struct file_mapping*
-get_file_mapping_by_mapid(mapid_t id)
+/* Handles setrss() system call. */
+static bool
+syscall_setrss(int scope, unsigned soft, unsigned hard)
 {
-    struct list *list = &thread_current ()->file_mapping_list;
-    struct list_elem *e;
-    for (e = list_begin (list); e != list_end (list); e = list_next (e))
+    switch (scope)
     {
-        struct file_mapping *mmap = list_entry (e, struct file_mapping, elem);
-        if (mmap->mapid == id)
-            return mmap;
+    case RSS_PROCESS:
+        return rss_set_limits(soft, hard);
+    case RSS_GROUP:
+        return rss_enter_group(soft, hard);
+    default:
+        return false;
     }
-    return NULL;
 }
 
-void
-unmap(struct file_mapping* m)
+/* Handles vmstat() system call. */
+static bool
+syscall_vmstat(int scope, struct vmstat *ust)
+{
+    struct vmstat st;
+
+    if (scope != VMSTAT_PROCESS && scope != VMSTAT_SYSTEM)
+        return false;
+    vmstat_get(scope, &st);
+    if (!copy_to_user(ust, &st, sizeof st))
+        syscall_exit(-1);
+    return true;
+}
+
+/* Handles wss() system call.  Fails if idle page tracking is
+   off. */
+static bool
+syscall_wss(struct wss *uwss)
+{
+    struct wss wss;
+
+    if (wss_period == 0)
+        return false;
+    frame_get_wss(&wss);
+    wss.period = wss_period;
+    if (!copy_to_user(uwss, &wss, sizeof wss))
+        syscall_exit(-1);
+    return true;
+}
+
+/* Handles faultstat() system call.  The statistics are too big
+   for the kernel stack, so they are copied through the heap. */
+static bool
+syscall_faultstat(struct faultstat *ust)
 {
-    lock_acquire (&filesys_lock);
+    struct faultstat *st = malloc(sizeof *st);
+    bool success;
+
+    if (st == NULL)
+        return false;
+    faultstat_get(st);
+    success = copy_to_user(ust, st, sizeof *st);
+    free(st);
+    if (!success)
+        syscall_exit(-1);
+    return true;
+}
 
-    for(int i=0; i< m->page_count ; i++)
+/* Handles shm_open() system call. */
+static int
+syscall_shm_open(const char *uname, int flags, unsigned size)
+{
+    struct file_descriptor_entry *fde;
+    char name[NAME_MAX + 1];
+
+    if (!get_file_name(name, uname) || name[0] == '\0'
+        || (flags & ~(SHM_CREAT | SHM_EXCL)) != 0)
+        return -1;
+
+    fde = palloc_get_page(0);
+    if (!fde)
+        return -1;
+    fde->shm = shm_lookup(name, flags, size);
+    if (fde->shm == NULL)
     {
-        struct page* page = page_find_by_upage(m->base + PGSIZE * i);
-        if(page == NULL) continue;
-        if(page->frame)
-        {
-            if(pagedir_is_dirty (page->thread->pagedir, page->upage))
-                file_write_at(page->file, page->frame->kpage, PGSIZE, PGSIZE * i);
-            frame_remove(page->frame, true);
-        }
-        pagedir_clear_page (page->thread->pagedir, page->upage);
-        hash_delete (page->thread->pages, &page->elem);
+        palloc_free_page(fde);
+        return -1;
     }
 
-    list_remove(&m->elem);
-    file_close(m->file);
-    free(m);
-    lock_release (&filesys_lock);
-    return;
+    fde->fd = thread_get_next_fd();
+    fde->file = NULL;
+    list_push_back(thread_get_fdt(), &fde->fdtelem);
+    return fde->fd;
 }
 
+/* Handles shm_unlink() system call. */
+static bool
+syscall_shm_unlink(const char *uname)
+{
+    char name[NAME_MAX + 1];
 
-static void
-clear_previous_pages(void* addr, off_t ofs)
+    if (!get_file_name(name, uname))
+        return false;
+    return shm_remove(name);
+}
+
+void
+mmap_file_write_at(struct file* file, void* addr, uint32_t read_bytes, off_t ofs)
 {
-    for(int i = 0 ; i < ofs; i = i + PGSIZE)
-        page_destory_by_upage(pg_round_down(addr + i), true);
-}
\ No newline at end of file
+    ASSERT(file != NULL);
+    lock_acquire(&filesys_lock);
+    file_write_at(file, addr, read_bytes, ofs);
+    lock_release(&filesys_lock);
+}
@@ -0,0 +1,158 @@
+#include "userprog/uaccess.h"
+#include <inttypes.h>
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "vm/page.h"
+
+/* Access to user memory from the kernel.
+
+   The primitives below touch user memory directly, without
+   checking that it is mapped first.  A page fault on user memory
+   is then handled like one raised by the process itself: the
+   page is loaded, or the stack grown, and the access restarted.
+   If the address is bad, page_fault() finds the faulting
+   instruction in the exception table and resumes at its fixup
+   instead of killing the process, and the primitive reports the
+   failure to its caller. */
+
+/* Exception table entry: a user access instruction and the code
+   to continue at if it faults.  The linker gathers the entries
+   emitted by the asm below between _start_ex_table and
+   _end_ex_table. */
+struct exception_entry
+    {
+        uintptr_t insn;
+        uintptr_t fixup;
+    };
+
+extern const struct exception_entry _start_ex_table[], _end_ex_table[];
+
+/* Returns true if [UADDR, UADDR + SIZE) is a range of user
+   addresses, without looking at what is mapped there. */
+static inline bool
+is_user_range(const void *uaddr, size_t size)
+{
+    return uaddr != NULL && (uintptr_t) uaddr + size >= (uintptr_t) uaddr
+        && (uintptr_t) uaddr + size <= (uintptr_t) PHYS_BASE;
+}
+
+/* Copies SIZE bytes from user address USRC to DST.
+    If USRC is bad, return false */
+bool
+copy_from_user(void *dst, const void *usrc, size_t size)
+{
+    if (!is_user_range(usrc, size))
+        return false;
+
+    asm volatile("1: rep movsb\n"
+                 "2:\n"
+                 ".section __ex_table, \"a\"\n"
+                 "   .long 1b, 2b\n"
+                 ".previous"
+                 : "+c"(size), "+S"(usrc), "+D"(dst)
+                 :
+                 : "memory");
+    return size == 0;
+}
+
+/* Copies SIZE bytes from SRC to user address UDST.
+    If UDST is bad, return false */
+bool
+copy_to_user(void *udst, const void *src, size_t size)
+{
+    if (!is_user_range(udst, size))
+        return false;
+
+    asm volatile("1: rep movsb\n"
+                 "2:\n"
+                 ".section __ex_table, \"a\"\n"
+                 "   .long 1b, 2b\n"
+                 ".previous"
+                 : "+c"(size), "+S"(src), "+D"(udst)
+                 :
+                 : "memory");
+    return size == 0;
+}
+
+/* Reads a byte at user address UADDR.
+    If it faults, return -1 */
+static inline int
+get_user(const uint8_t *uaddr)
+{
+    int result;
+    asm volatile("1: movzbl %1, %0\n"
+                 "   jmp 3f\n"
+                 "2: movl $-1, %0\n"
+                 "3:\n"
+                 ".section __ex_table, \"a\"\n"
+                 "   .long 1b, 2b\n"
+                 ".previous"
+                 : "=r"(result)
+                 : "m"(*uaddr));
+    return result;
+}
+
+/* Copies the string at user address USRC into DST, which has
+    room for SIZE bytes including the null terminator.
+    If USRC is bad, return -1.
+    If the string is too long, return SIZE; DST holds its first
+    SIZE - 1 characters.
+    Otherwise, return the length of the string */
+int
+strncpy_from_user(char *dst, const char *usrc, size_t size)
+{
+    size_t i;
+
+    ASSERT(size > 0);
+    for (i = 0; i < size; i++)
+    {
+        if (!is_user_range(usrc + i, 1))
+            return -1;
+
+        int c = get_user((const uint8_t *) usrc + i);
+        if (c < 0)
+            return -1;
+        dst[i] = c;
+        if (c == '\0')
+            return i;
+    }
+    dst[size - 1] = '\0';
+    return size;
+}
+
+/* Returns true if every page of [UADDR, UADDR + SIZE) is mapped
+    in the current process, or is a stack page, which is then
+    created.  Looks up each page once, for buffers the kernel
+    hands to code that cannot recover from a bad address. */
+bool
+check_user_range(const void *uaddr, size_t size)
+{
+    if (!is_user_range(uaddr, size))
+        return false;
+    if (size == 0)
+        return true;
+
+    const void *addr = uaddr;
+    void *last = pg_round_down(uaddr + size - 1);
+    for (; addr <= last; addr = pg_round_down(addr) + PGSIZE)
+        if (page_find_by_upage(pg_round_down(addr)) == NULL
+            && !page_grow_stack(addr, thread_current()->user_esp))
+            return false;
+    return true;
+}
+
+/* If the kernel faulted at an instruction in the exception table,
+    makes F resume at its fixup and return true */
+bool
+uaccess_fixup(struct intr_frame *f)
+{
+    const struct exception_entry *e;
+
+    for (e = _start_ex_table; e < _end_ex_table; e++)
+        if (e->insn == (uintptr_t) f->eip)
+        {
+            f->eip = (void (*)(void)) e->fixup;
+            return true;
+        }
+    return false;
+}
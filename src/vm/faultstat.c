@@ -0,0 +1,157 @@
+#include "vm/faultstat.h"
+#include <stdio.h>
+#include <string.h>
+#include "devices/timer.h"
+#include "threads/interrupt.h"
+#include "threads/thread.h"
+
+/* Number of slowest faults kept, up to FAULT_TRACE_MAX, or 0 for
+   none.  Set with the -fault-trace=N kernel option. */
+size_t faultstat_trace_max;
+
+/* Latency histograms and the trace of the slowest faults, slowest
+   first.  Faults are rare enough next to the cycles they take
+   that the counts are updated with interrupts off instead of
+   under a lock. */
+static struct faultstat stats;
+
+static const char* type_names[VMSTAT_TYPES] = {"zero", "file", "mmap", "swap", "shm"};
+
+/* Starts timing the current thread's page fault in clock, in the
+    FAULT_LOOKUP phase. */
+void
+faultstat_begin(struct fault_clock* clock)
+{
+    memset(clock, 0, sizeof *clock);
+    clock->start = clock->last = timer_cycles();
+    clock->phase = FAULT_LOOKUP;
+    thread_current()->fault_clock = clock;
+}
+
+/* Charges the time since the last switch to the phase under way
+    and starts phase, returning the phase it replaces so that the
+    caller can switch back.  Does nothing outside a page fault. */
+int
+faultstat_phase(int phase)
+{
+    struct fault_clock* clock = thread_current()->fault_clock;
+    uint64_t now;
+    int prev;
+
+    if(clock == NULL)
+        return phase;
+    now = timer_cycles();
+    prev = clock->phase;
+    clock->cycles[prev] += now - clock->last;
+    clock->last = now;
+    clock->phase = phase;
+    return prev;
+}
+
+/* Returns the histogram bucket of a fault that took cycles. */
+static int
+bucket_of(uint64_t cycles)
+{
+    int bucket = 0;
+    while(cycles > 1 && bucket < FAULT_BUCKETS - 1)
+    {
+        cycles /= 2;
+        bucket++;
+    }
+    return bucket;
+}
+
+/* Keeps the fault timed by clock in the trace if it is among the
+    faultstat_trace_max slowest. */
+static void
+trace_fault(const struct fault_clock* clock, uint64_t cycles,
+            const void* upage, int type)
+{
+    size_t max = faultstat_trace_max < FAULT_TRACE_MAX ? faultstat_trace_max
+                                                       : FAULT_TRACE_MAX;
+    struct fault_record* r;
+    size_t i;
+
+    if(max == 0 || (stats.trace_cnt == (int) max
+                    && stats.trace[max - 1].cycles >= (long long) cycles))
+        return;
+    if(stats.trace_cnt < (int) max)
+        stats.trace_cnt++;
+    for(i = stats.trace_cnt - 1;
+        i > 0 && stats.trace[i - 1].cycles < (long long) cycles; i--)
+        stats.trace[i] = stats.trace[i - 1];
+
+    r = &stats.trace[i];
+    r->addr = (void*) upage;
+    r->type = type;
+    r->tid = thread_current()->tid;
+    r->cycles = cycles;
+    for(i = 0; i < FAULT_PHASES; i++)
+        r->phase_cycles[i] = clock->cycles[i];
+}
+
+/* Stops timing the current thread's page fault at upage, on a page
+    of the given type.  Only faults that were resolved count. */
+void
+faultstat_end(const void* upage, int type, bool resolved)
+{
+    struct thread* t = thread_current();
+    struct fault_clock* clock = t->fault_clock;
+    enum intr_level old_level;
+    uint64_t cycles;
+
+    if(clock == NULL)
+        return;
+    faultstat_phase(clock->phase);
+    t->fault_clock = NULL;
+    if(!resolved)
+        return;
+
+    cycles = clock->last - clock->start;
+    old_level = intr_disable();
+    stats.hist[type][bucket_of(cycles)]++;
+    trace_fault(clock, cycles, upage, type);
+    intr_set_level(old_level);
+}
+
+/* Copies the histograms and the trace into st. */
+void
+faultstat_get(struct faultstat* st)
+{
+    enum intr_level old_level = intr_disable();
+    *st = stats;
+    intr_set_level(old_level);
+}
+
+/* Prints the histograms, one line of nonzero buckets per page type,
+    and the trace. */
+void
+faultstat_print_stats(void)
+{
+    int type, i;
+
+    for(type = 0; type < VMSTAT_TYPES; type++)
+    {
+        bool any = false;
+        for(i = 0; i < FAULT_BUCKETS; i++)
+            if(stats.hist[type][i] > 0)
+            {
+                if(!any)
+                    printf("Fault: %s latency, faults by log2 cycles:", type_names[type]);
+                printf(" %d:%lld", i, stats.hist[type][i]);
+                any = true;
+            }
+        if(any)
+            printf("\n");
+    }
+    for(i = 0; i < stats.trace_cnt; i++)
+    {
+        const struct fault_record* r = &stats.trace[i];
+        printf("Fault: slow %s fault at %p by thread %d: %lld cycles: %lld lookup, "
+               "%lld frame, %lld evict, %lld I/O, %lld map\n",
+               type_names[r->type], r->addr, r->tid, r->cycles,
+               r->phase_cycles[FAULT_LOOKUP], r->phase_cycles[FAULT_FRAME],
+               r->phase_cycles[FAULT_EVICT], r->phase_cycles[FAULT_IO],
+               r->phase_cycles[FAULT_MAP]);
+    }
+}
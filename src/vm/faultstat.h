@@ -0,0 +1,26 @@
+#ifndef VM_FAULTSTAT_H
+#define VM_FAULTSTAT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "userprog/process.h"
+
+/* Timing of the page fault a thread is handling, split into the
+   FAULT_* phases of struct faultstat. */
+struct fault_clock
+    {
+        uint64_t start;                     /* When the fault began. */
+        uint64_t last;                      /* When the phase began. */
+        int phase;                          /* Phase under way. */
+        uint64_t cycles[FAULT_PHASES];      /* Cycles spent in each phase. */
+    };
+
+extern size_t faultstat_trace_max;
+
+void faultstat_begin(struct fault_clock* clock);
+int faultstat_phase(int phase);
+void faultstat_end(const void* upage, int type, bool resolved);
+void faultstat_get(struct faultstat* st);
+void faultstat_print_stats(void);
+
+#endif
@@ -2,14 +2,22 @@
 #include <stdio.h>
 #include <list.h>
 #include <bitmap.h>
+#include <string.h>
+#include "vm/faultstat.h"
 #include "vm/page.h"
+#include "vm/rss.h"
+#include "vm/shm.h"
 #include "vm/swap.h"
+#include "vm/vmstat.h"
+#include "filesys/file.h"
+#include "filesys/inode.h"
 #include "threads/malloc.h"
 #include "threads/palloc.h"
 #include "threads/synch.h"
 #include "threads/vaddr.h"
 #include "threads/thread.h"
 #include "userprog/pagedir.h"
+#include "userprog/process.h"
 #include "userprog/syscall.h"
 
 static struct list frames;
@@ -18,6 +26,68 @@ static struct lock frames_lock;
 
 static struct list_elem* frame_clock_points;
 
+/* Front hand of the two-handed clock, which runs
+   frame_hand_spread frames ahead of frame_clock_points. */
+static struct list_elem* frame_front_hand;
+
+/* Frames on the frames list, and how many of them are not hot
+   (A1in of the 2Q policy). */
+static size_t frame_cnt;
+static size_t frame_cold_cnt;
+
+/* Next frame frame_merge_scan() looks at. */
+static struct list_elem* merge_hand;
+
+/* Frames on the frames list that madvise() marked for early
+   eviction (see frame_deactivate()). */
+static size_t frame_reclaim_cnt;
+
+/* Distance between the hands of the two-handed clock.  Set with
+   the -evict-spread=N kernel option. */
+size_t frame_hand_spread = 16;
+
+/* Page replacement policies, chosen with the -evict=NAME kernel
+   option.  Each picks a victim among the frames list, which holds
+   the evictable frames in the order they were loaded. */
+struct evict_policy
+    {
+        const char* name;
+        struct frame* (*select)(void);  /* Returns the frame to evict. */
+        bool (*is_hot)(struct page*);   /* Loads page into a hot frame? */
+    };
+
+static struct frame* clock_select(void);
+static struct frame* wsclock_select(void);
+static struct frame* clock2_select(void);
+static struct frame* twoq_select(void);
+static bool twoq_is_hot(struct page* page);
+static struct frame* reclaim_select(void);
+
+static const struct evict_policy policies[] =
+    {
+        {"clock", clock_select, NULL},
+        {"wsclock", wsclock_select, NULL},
+        {"clock2", clock2_select, NULL},
+        {"2q", twoq_select, twoq_is_hot},
+    };
+
+static const struct evict_policy* policy = &policies[0];
+
+/* Statistics. */
+static long long evict_cnt;         /* Frames evicted. */
+static long long evict_dirty_cnt;   /* Of which had to be written. */
+static long long writeback_cnt;     /* Written back ahead of eviction. */
+static long long evict_local_cnt;   /* Evicted by their process's limit. */
+static long long merge_scan_cnt;    /* Frames scanned for merging. */
+static long long merge_cnt;         /* Pages merged onto another's frame. */
+static long long idle_scan_cnt;     /* Scans for idle frames. */
+static long long idle_reclaim_cnt;  /* Frames evicted for being idle. */
+
+/* Read faults on zero-filled pages map this frame read-only
+   instead of a frame of their own.  It is never on the frames
+   list, so it is never evicted, and never freed. */
+static struct frame* zero_frame;
+
 static inline bool
 is_tail(struct list_elem *elem)
 {
@@ -30,79 +100,334 @@ is_back(struct list_elem *elem)
     return list_back(&frames) == elem;
 }
 
+
+/* Reverse mapping.  frame->pages lists every page that maps a
+   frame, and each page names its mapper: the page directory of
+   its thread and its user address.  Sharing a frame, between
+   processes that map the same code, pages on the zero frame,
+   copy-on-write pages after fork() or merged identical pages,
+   only adds pages to the list, and the functions below act on
+   every mapper at once.  All of them expect frames_lock held. */
+
+/* Returns true if any mapper of frame wrote it.  Only the user
+    mappings count: the kernel writes a frame through its kernel
+    address only while loading it, before it is mapped, and that
+    address may lie in a 4 MB page whose dirty bit covers a
+    thousand other frames. */
+static bool
+rmap_is_dirty(struct frame* frame)
+{
+    struct list_elem* e;
+    for (e = list_begin(&frame->pages); e != list_end(&frame->pages); e = list_next(e))
+    {
+        struct page* page = list_entry(e, struct page, frame_elem);
+        if (pagedir_is_dirty(page->thread->pagedir, page->upage))
+            return true;
+    }
+    return false;
+}
+
+/* Clears the dirty bits rmap_is_dirty() tests */
+static void
+rmap_clear_dirty(struct frame* frame)
+{
+    struct list_elem* e;
+    for (e = list_begin(&frame->pages); e != list_end(&frame->pages); e = list_next(e))
+    {
+        struct page* page = list_entry(e, struct page, frame_elem);
+        pagedir_set_dirty(page->thread->pagedir, page->upage, false);
+    }
+}
+
+/* Returns true if any mapper of frame accessed it, clearing the
+    accessed bits as a side effect.  A use that frame_idle_scan()
+    saw and cleared first counts too.  A use found here also ends
+    the frame's idle run, so that the clock hand clearing the bits
+    between two idle scans does not make a busy frame look idle. */
+static bool
+rmap_test_and_clear_accessed(struct frame* frame)
+{
+    bool accessed = frame->young;
+    struct list_elem* e;
+
+    frame->young = false;
+    for (e = list_begin(&frame->pages); e != list_end(&frame->pages); e = list_next(e))
+    {
+        struct page* page = list_entry(e, struct page, frame_elem);
+        if (pagedir_is_accessed(page->thread->pagedir, page->upage))
+        {
+            pagedir_set_accessed(page->thread->pagedir, page->upage, false);
+            accessed = true;
+        }
+    }
+    if(accessed)
+        frame->idle = 0;
+    return accessed;
+}
+
+/* Maps frame read-only for every mapper, so that its contents
+    stay put until frames_lock is released. */
+static void
+rmap_write_protect(struct frame* frame)
+{
+    struct list_elem* e;
+    for (e = list_begin(&frame->pages); e != list_end(&frame->pages); e = list_next(e))
+    {
+        struct page* page = list_entry(e, struct page, frame_elem);
+        pagedir_set_writable(page->thread->pagedir, page->upage, false);
+    }
+}
+
+/* Unmaps frame from every mapper and empties its list of pages,
+    uncharging each from its process's resident set. */
+static void
+rmap_unmap(struct frame* frame)
+{
+    while(!list_empty(&frame->pages))
+    {
+        struct page* page = list_entry(list_pop_front(&frame->pages), struct page, frame_elem);
+        page->frame = NULL;
+        pagedir_clear_page(page->thread->pagedir, page->upage);
+        rss_charge(page->thread, -1);
+    }
+}
+
+/* Returns true if evicting frame costs a write, to swap or to
+    its file. */
+static inline bool
+needs_writeback(struct frame* frame)
+{
+    /* Shared memory has nowhere to go but swap; a frame that no
+       process maps has no dirty bits to tell either. */
+    if(frame->shm != NULL)
+        return true;
+
+    struct page* page = list_entry(list_front(&frame->pages), struct page, frame_elem);
+    switch (page->type)
+    {
+    case PAGE_ZERO:
+        return !frame->lazy_free || rmap_is_dirty(frame);
+    case PAGE_MMAP:
+        return rmap_is_dirty(frame);
+    case PAGE_FILE:
+        return page->writable && rmap_is_dirty(frame);
+    default:
+        NOT_REACHED();
+    }
+}
+
+
+/* Returns true if frame must be copied before one of its pages
+    is written: it is the zero frame, several pages share it
+    privately, or it caches a file page other processes may map
+    later.  Shared memory pages are written in place by all, and
+    so is a merged frame by the last page left on it, once
+    merge_leave() has taken it out of stable_frames. */
+static inline bool
+needs_copy(struct frame* frame)
+{
+    return frame == zero_frame || frame->shared
+        || (list_size(&frame->pages) > 1 && frame->shm == NULL);
+}
+
+/* Read-only pages of a running executable may be mapped by
+   several processes at once.  Such frames are registered in
+   shared_frames, keyed by the inode sector and offset of the file
+   page they hold.  Only files that deny writes qualify: a private
+   read-only mapping of an ordinary file can be written behind the
+   cached frame's back. */
 static inline bool
-is_dirty(struct frame* frame)
+is_shareable(struct page* page)
 {
-    return pagedir_is_dirty(get_pagedir_of_frame(frame), frame->page->upage)
-    || pagedir_is_dirty(get_pagedir_of_frame(frame), frame->kpage);
+    return page->type == PAGE_FILE && !page->writable && page->file != NULL
+        && file_denies_write(page->file);
 }
 
+static struct hash shared_frames;
+
+/* Same-page merging maps pages with identical contents onto one
+   read-only frame, copied on the next write like a frame shared
+   by fork().  Merged frames are kept in stable_frames by checksum.
+   Candidates wait in unstable_frames, also by checksum, until a
+   second frame with the same contents turns up; they stay
+   writable, so their contents may drift, and the table is emptied
+   on every pass over the frames list.  Each table holds one frame
+   per checksum, and a match is only merged after both frames are
+   write-protected and compared in full. */
+static struct hash stable_frames;
+static struct hash unstable_frames;
+
+static hash_hash_func share_hash_func;
+static hash_less_func share_less_func;
+static hash_hash_func merge_hash_func;
+static hash_less_func merge_less_func;
+static struct frame* share_find(struct page* page);
+static void share_remove(struct frame* frame);
+static void merge_leave(struct frame* frame);
+static struct frame* frame_create(void* kpage);
+static struct frame* frame_evict_local(void);
+static bool swap_shm_frame(struct frame* frame);
+static void frame_free(struct frame* frame, struct page* page);
+
 void
 frame_init (void)
 {
     lock_init(&frames_lock);
     list_init(&frames);
-    frame_clock_points = list_tail(&frames);
+    frame_clock_points = frame_front_hand = merge_hand = list_tail(&frames);
+    hash_init(&shared_frames, share_hash_func, share_less_func, NULL);
+    hash_init(&stable_frames, merge_hash_func, merge_less_func, NULL);
+    hash_init(&unstable_frames, merge_hash_func, merge_less_func, NULL);
+
+    zero_frame = frame_create(palloc_get_page(PAL_ZERO | PAL_ASSERT));
+    if(zero_frame == NULL)
+        PANIC("frame_init: can't allocate the zero frame");
 }
 
-/* Allocate frame, and register page with given page
-    If no free space, evict and allocate. 
+
+/* Allocate frame for a page of the current process.  Pages are
+    attached when it is pushed.
+    If no free space, evict and allocate.  A process at its hard
+    RSS limit evicts one of its own pages instead, even if there is
+    free space; one over its soft limit does so before evicting
+    other processes' pages.
     If failed to allocate,  return NULL
     Otherwise, return allocated frame */
 struct frame*
-frame_allocate(struct page* page)
+frame_allocate(void)
 {
+    int phase = faultstat_phase(FAULT_FRAME);
+    enum rss_state state = rss_get_state(thread_current());
     lock_acquire(&frames_lock);
 
     struct frame* new_frame = NULL;
-    void* kpage = palloc_get_page(PAL_USER);
-    if(kpage == NULL) //No free page, eviction needs
-        new_frame = frame_evict_and_reassign(page);
-    else
+    if(state == RSS_HARD)
     {
-        new_frame = malloc(sizeof(struct frame));
-
-        if(new_frame == NULL) 
-        {
-            palloc_free_page(kpage);
-        }
-        else
+        faultstat_phase(FAULT_EVICT);
+        new_frame = frame_evict_local();
+        faultstat_phase(FAULT_FRAME);
+    }
+    if(new_frame == NULL)
+    {
+        void* kpage = palloc_get_page(PAL_USER);
+        if(kpage != NULL)
+            new_frame = frame_create(kpage);
+        else //No free page, eviction needs
         {
-            new_frame->kpage = kpage;
-            new_frame->page = page;
+            faultstat_phase(FAULT_EVICT);
+            if(state == RSS_SOFT)
+                new_frame = frame_evict_local();
+            if(new_frame == NULL)
+                new_frame = frame_evict_and_reassign();
         }
     }
 
     lock_release(&frames_lock);
+    faultstat_phase(phase);
+    return new_frame;
+}
+
+/* Allocate frame only if a free user page is available and the
+    current process is within its RSS limits.
+    Never evicts, so it is safe for speculative loads.
+    If no free page, return NULL */
+struct frame*
+frame_try_allocate(void)
+{
+    if(rss_get_state(thread_current()) != RSS_UNDER)
+        return NULL;
+
+    struct frame* new_frame = NULL;
+    int phase = faultstat_phase(FAULT_FRAME);
+    void* kpage = palloc_get_page(PAL_USER);
+    if(kpage != NULL)
+    {
+        lock_acquire(&frames_lock);
+        new_frame = frame_create(kpage);
+        lock_release(&frames_lock);
+    }
+    faultstat_phase(phase);
+    return new_frame;
+}
+
+/* Wraps KPAGE in a new frame that is not yet on the frames list.
+    If failed, free KPAGE and return NULL */
+static struct frame*
+frame_create(void* kpage)
+{
+    struct frame* new_frame = malloc(sizeof(struct frame));
+
+    if(new_frame == NULL) 
+    {
+        palloc_free_page(kpage);
+        return NULL;
+    }
+
+    new_frame->kpage = kpage;
+    new_frame->shared = false;
+    new_frame->merge = MERGE_NONE;
+    new_frame->checksum = 0;
+    new_frame->reclaim = new_frame->lazy_free = false;
+    new_frame->idle = 0;
+    new_frame->young = false;
+    new_frame->shm = NULL;
+    new_frame->pin_cnt = 0;
+    list_init(&new_frame->pages);
+    new_frame->elem.prev = new_frame->elem.next = NULL;
     return new_frame;
 }
 
 struct frame*
-frame_evict_and_reassign(struct page* page)
+frame_evict_and_reassign(void)
 {
     ASSERT (lock_held_by_current_thread (&frames_lock));
     struct frame* frame = frame_to_evict();
     if(frame == NULL) return NULL;
     
     if(!frame_evict(frame)) return NULL;
-    frame_page_reassign_and_remove_list(frame, page);
+    frame_page_reassign_and_remove_list(frame);
     return frame;
 }
 
 
+/* Evict frame, unmapping it from every page that shares it
+    through the reverse map.  All sharers of a frame hold the same
+    kind of page: read-only file pages, pages of one shared file
+    mapping, copy-on-write pages of forked processes or of
+    same-page merging, which share one swap slot, or pages of one
+    shared memory segment.  A segment's frame may have no pages at
+    all. */
 bool
 frame_evict(struct frame* frame)
 {
     ASSERT (lock_held_by_current_thread (&frames_lock));
 
-    struct page* page = frame->page;
-    bool dirty = is_dirty(frame);
+    struct page* page = list_empty(&frame->pages) ? NULL
+        : list_entry(list_front(&frame->pages), struct page, frame_elem);
+    bool dirty = rmap_is_dirty(frame);
+    struct list_elem* e;
 
-    page->prev_type = page->type;
-    switch (page->type)
+    evict_cnt++;
+    if(needs_writeback(frame))
+    {
+        evict_dirty_cnt++;
+        if(page != NULL)
+            VMSTAT_ADD(page->thread, writebacks, 1);
+        else
+            vmstat_system.writebacks++;
+    }
+    for (e = list_begin(&frame->pages); e != list_end(&frame->pages); e = list_next(e))
+    {
+        struct page* p = list_entry(e, struct page, frame_elem);
+        VMSTAT_ADD(p->thread, evictions[p->type], 1);
+    }
+    if(page == NULL)
+        vmstat_system.evictions[PAGE_SHM]++;
+    switch (frame->shm != NULL ? PAGE_SHM : page->type)
     {
     case PAGE_ZERO:
-        if(!swap_frame(page, frame)) return false;
+        /* Unless madvise(MADV_FREE) let its data go. */
+        if((!frame->lazy_free || dirty) && !swap_frame(frame)) return false;
         break;
     
     case PAGE_MMAP:
@@ -112,7 +437,11 @@ frame_evict(struct frame* frame)
     
     case PAGE_FILE:
         if(page->writable && dirty)
-            if(!swap_frame(page, frame)) return false;
+            if(!swap_frame(frame)) return false;
+        break;
+
+    case PAGE_SHM:
+        if(!swap_shm_frame(frame)) return false;
         break;
 
     default:
@@ -120,25 +449,78 @@ frame_evict(struct frame* frame)
         break;
     }
 
-    page->frame = NULL;
-    pagedir_clear_page(get_pagedir_of_frame(frame), page->upage);
+    share_remove(frame);
+    rmap_unmap(frame);
     return true;
 }
 
-/* CLock Algorithm */
-struct frame*
-frame_to_evict(void) 
+/* Evicts one of the current process's own frames, chosen by a
+    clock over its address space that starts where the last one
+    stopped, and returns it for reuse.  Frames shared with other
+    pages or pinned are passed over.
+    If there is none to evict, return NULL */
+static struct frame*
+frame_evict_local(void)
 {
     ASSERT (lock_held_by_current_thread (&frames_lock));
 
-    struct frame* frame = frame_clock_forward();
-    while(pagedir_is_accessed (get_pagedir_of_frame(frame), frame->page->upage))
+    struct process* pcb = thread_current()->pcb;
+    size_t i;
+
+    /* Two turns clear every accessed bit. */
+    for(i = 0; i <= 2 * pcb->rss; i++)
     {
-        pagedir_set_accessed (get_pagedir_of_frame(frame), frame->page->upage, false);
-        frame = frame_clock_forward();
+        struct page* page = page_next_resident(pcb->rss_hand);
+        if(page == NULL)
+            return NULL;
+        pcb->rss_hand = (uint8_t*) page->upage + PGSIZE;
+
+        struct frame* frame = page->frame;
+        if(frame == zero_frame || frame->elem.next == NULL || frame->pin_cnt > 0
+           || list_size(&frame->pages) != 1 || rmap_test_and_clear_accessed(frame))
+            continue;
+        if(!frame_evict(frame))
+            return NULL;
+        evict_local_cnt++;
+        frame_page_reassign_and_remove_list(frame);
+        return frame;
     }
+    return NULL;
+}
 
-    return frame;
+/* Chooses the frame to evict: one madvise() marked, if any is
+    still unused, otherwise the current policy's choice.
+    If every frame is pinned, return NULL */
+struct frame*
+frame_to_evict(void) 
+{
+    ASSERT (lock_held_by_current_thread (&frames_lock));
+    struct frame* frame = frame_reclaim_cnt > 0 ? reclaim_select() : NULL;
+    return frame != NULL ? frame : policy->select();
+}
+
+/* Selects the page replacement policy called name.
+    If there is no such policy, return false */
+bool
+frame_set_policy(const char* name)
+{
+    size_t i;
+    for(i = 0; i < sizeof policies / sizeof *policies; i++)
+        if(!strcmp(policies[i].name, name))
+        {
+            policy = &policies[i];
+            return true;
+        }
+    return false;
+}
+
+/* Returns the element after hand on the frames list, going round
+    to the front after the back */
+static struct list_elem*
+hand_forward(struct list_elem* hand)
+{
+    if(is_tail(hand) || is_back(hand)) return list_front(&frames);
+    return list_next(hand);
 }
 
 struct frame*
@@ -146,31 +528,282 @@ frame_clock_forward(void)
 {
     ASSERT (lock_held_by_current_thread (&frames_lock));
 
-    struct list_elem* next_elem;
-    if(is_tail(frame_clock_points) || is_back(frame_clock_points)) next_elem = list_front(&frames);
-    else next_elem = list_next(frame_clock_points);
+    if(is_tail(frame_clock_points) || is_back(frame_clock_points))
+        vmstat_system.clock_turns++;
+    frame_clock_points = hand_forward(frame_clock_points);
+    return list_entry (frame_clock_points, struct frame, elem);
+}
 
-    frame_clock_points = next_elem;
-    return list_entry (next_elem, struct frame, elem);
+/* CLock Algorithm.  Two turns clear every accessed bit, so a
+    frame is found by then unless all of them are pinned.
+    If every frame is pinned, return NULL */
+static struct frame*
+clock_select(void)
+{
+    size_t i;
+    for(i = 0; i < 2 * frame_cnt; i++)
+    {
+        struct frame* frame = frame_clock_forward();
+        if(frame->pin_cnt == 0 && !rmap_test_and_clear_accessed(frame))
+            return frame;
+    }
+    return NULL;
 }
 
+/* Largest number of dirty file mapping frames one WSClock scan
+    writes back. */
+#define WSCLOCK_MAX_WRITES 8
+
+/* WSClock: a clock that prefers clean frames.  A dirty frame not
+    used since the last turn is passed over; if it belongs to a
+    file mapping its data is written back, so that it is clean
+    when the hand comes round again.  Anonymous pages have nowhere
+    to go but swap, so they are only passed over.  If two turns
+    find no clean frame, the first dirty one is evicted. */
+static struct frame*
+wsclock_select(void)
+{
+    struct frame* dirty = NULL;
+    size_t writes = 0, i;
+
+    for(i = 0; i < 2 * frame_cnt; i++)
+    {
+        struct frame* frame = frame_clock_forward();
+        if(frame->pin_cnt > 0 || rmap_test_and_clear_accessed(frame))
+            continue;
+        if(!needs_writeback(frame))
+            return frame;
+
+        struct page* page = frame->shm != NULL ? NULL
+            : list_entry(list_front(&frame->pages), struct page, frame_elem);
+        if(page != NULL && page->type == PAGE_MMAP && writes < WSCLOCK_MAX_WRITES)
+        {
+            rmap_clear_dirty(frame);
+            mmap_file_write_at(page->file, frame->kpage, page->read_bytes, page->ofs);
+            VMSTAT_ADD(page->thread, writebacks, 1);
+            writeback_cnt++;
+            writes++;
+        }
+        else if(dirty == NULL)
+            dirty = frame;
+    }
+
+    if(dirty == NULL)
+        return clock_select();
+    frame_clock_points = &dirty->elem;
+    return dirty;
+}
+
+/* Two-handed clock: the front hand clears accessed bits
+    frame_hand_spread frames ahead of the back hand, which evicts
+    the first frame not used in between.  A small spread reclaims
+    quickly; a spread of the whole list is the plain clock.
+    If two turns of the back hand find every frame pinned, return
+    NULL */
+static struct frame*
+clock2_select(void)
+{
+    size_t i;
+
+    if(frame_cnt == 0)
+        return NULL;
+    if(is_tail(frame_front_hand))
+    {
+        size_t spread = frame_hand_spread < frame_cnt ? frame_hand_spread : frame_cnt - 1;
+
+        frame_front_hand = frame_clock_points;
+        for(i = 0; i < spread; i++)
+        {
+            frame_front_hand = hand_forward(frame_front_hand);
+            rmap_test_and_clear_accessed(list_entry(frame_front_hand, struct frame, elem));
+        }
+    }
+
+    for(i = 0; i < 2 * frame_cnt; i++)
+    {
+        frame_front_hand = hand_forward(frame_front_hand);
+        rmap_test_and_clear_accessed(list_entry(frame_front_hand, struct frame, elem));
+
+        struct frame* frame = frame_clock_forward();
+        if(!rmap_test_and_clear_accessed(frame) && frame->pin_cnt == 0)
+            return frame;
+    }
+    return NULL;
+}
+
+/* 2Q keeps frames loaded for the first time in a FIFO (A1in: the
+    frames that are not hot).  The pages it evicts are remembered
+    in a ghost queue (A1out); a page that faults back in while
+    remembered is loaded hot, into the main queue (Am), which the
+    clock manages.  A single scan over a large region therefore
+    only cycles A1in and never flushes Am. */
+#define TWOQ_GHOSTS 256
+
+/* A1out: recently evicted pages, by page directory and address. */
+static struct ghost
+    {
+        uint32_t* pagedir;
+        void* upage;
+    }
+ghosts[TWOQ_GHOSTS];
+static size_t ghost_next;
+
+static struct frame*
+twoq_select(void)
+{
+    struct list_elem* e;
+    struct frame* frame;
+
+    /* A1in may take a quarter of the frames. */
+    if(frame_cold_cnt > frame_cnt / 4 || frame_cold_cnt == frame_cnt)
+        for(e = list_begin(&frames); e != list_end(&frames); e = list_next(e))
+        {
+            frame = list_entry(e, struct frame, elem);
+            if(frame->hot || frame->pin_cnt > 0)
+                continue;
+
+            struct list_elem* p;
+            for(p = list_begin(&frame->pages); p != list_end(&frame->pages); p = list_next(p))
+            {
+                struct page* page = list_entry(p, struct page, frame_elem);
+                ghosts[ghost_next].pagedir = page->thread->pagedir;
+                ghosts[ghost_next].upage = page->upage;
+                ghost_next = (ghost_next + 1) % TWOQ_GHOSTS;
+            }
+            return frame;
+        }
+
+    if(frame_cold_cnt == frame_cnt)
+        return clock_select();
+
+    /* If every hot frame is pinned, take any frame the clock finds. */
+    size_t i;
+    for(i = 0; i < 2 * frame_cnt; i++)
+    {
+        frame = frame_clock_forward();
+        if(frame->hot && frame->pin_cnt == 0 && !rmap_test_and_clear_accessed(frame))
+            return frame;
+    }
+    return clock_select();
+}
+
+/* Returns true if page is in A1out, taking it out */
+static bool
+twoq_is_hot(struct page* page)
+{
+    size_t i;
+    for(i = 0; i < TWOQ_GHOSTS; i++)
+        if(ghosts[i].upage == page->upage && ghosts[i].pagedir == page->thread->pagedir)
+        {
+            ghosts[i].pagedir = NULL;
+            ghosts[i].upage = NULL;
+            return true;
+        }
+    return false;
+}
+
+/* Returns the first frame marked by frame_deactivate() that is
+    not pinned and was not used since, or NULL.  Marked frames that
+    were used lose the mark. */
+static struct frame*
+reclaim_select(void)
+{
+    struct list_elem* e;
+    for(e = list_begin(&frames); e != list_end(&frames) && frame_reclaim_cnt > 0; e = list_next(e))
+    {
+        struct frame* frame = list_entry(e, struct frame, elem);
+        if(!frame->reclaim || frame->pin_cnt > 0)
+            continue;
+        if(!rmap_test_and_clear_accessed(frame))
+            return frame;
+        frame->reclaim = false;
+        frame_reclaim_cnt--;
+    }
+    return NULL;
+}
+
+/* Swap out frame once; every page sharing it takes a reference
+    to the same swap slot. */
 bool
-swap_frame(struct page* page, struct frame* frame)
+swap_frame(struct frame* frame)
 {
-    page->swap_index = swap_out(frame->kpage);
-    if(page->swap_index == BITMAP_ERROR) 
+    size_t swap_index = swap_out(frame->kpage);
+    if(swap_index == BITMAP_ERROR) 
         return false;
-    else
+
+    struct list_elem* e;
+    for (e = list_begin(&frame->pages); e != list_end(&frame->pages); e = list_next(e))
+    {
+        struct page* page = list_entry(e, struct page, frame_elem);
+        if(e != list_begin(&frame->pages))
+            swap_dup(swap_index);
+        VMSTAT_ADD(page->thread, swap_outs, 1);
         page->type = PAGE_SWAP;
-    
+        page->file = NULL;
+        page->swap_index = swap_index;
+    }
     return true;
 }
 
-void
-frame_page_reassign_and_remove_list(struct frame* frame, struct page* page)
+/* Swaps out frame, which holds a page of a shared memory segment,
+    into the segment's slot for the page, where shm_fill() finds it
+    for whichever process maps the page next.  Its pages, if any,
+    stay PAGE_SHM. */
+static bool
+swap_shm_frame(struct frame* frame)
+{
+    size_t swap_index = swap_out(frame->kpage);
+    if(swap_index == BITMAP_ERROR)
+        return false;
+
+    struct list_elem* e;
+    for (e = list_begin(&frame->pages); e != list_end(&frame->pages); e = list_next(e))
+        VMSTAT_ADD(list_entry(e, struct page, frame_elem)->thread, swap_outs, 1);
+    if(list_empty(&frame->pages))
+        vmstat_system.swap_outs++;
+
+    frame->shm->frames[frame->shm_index] = NULL;
+    frame->shm->slots[frame->shm_index] = swap_index;
+    frame->shm = NULL;
+    return true;
+}
+
+/* Puts frame, just loaded for page, on the frames list */
+static void
+frame_link(struct frame* frame, struct page* page)
+{
+    frame->hot = policy->is_hot != NULL && policy->is_hot(page);
+    frame->reclaim = frame->lazy_free = false;
+    frame->checksum = 0;
+    list_push_back (&frames, &frame->elem);
+    frame_cnt++;
+    frame_cold_cnt += !frame->hot;
+}
+
+/* Takes frame off the frames list, keeping the clock hands on
+    the list */
+static void
+frame_unlink(struct frame* frame)
 {
-    frame->page = page;
+    if(frame_clock_points == &frame->elem) 
+        frame_clock_points = list_prev(frame_clock_points);
+    if(frame_front_hand == &frame->elem) 
+        frame_front_hand = list_prev(frame_front_hand);
+    if(merge_hand == &frame->elem)
+        merge_hand = list_prev(merge_hand);
+
+    frame_cnt--;
+    frame_cold_cnt -= !frame->hot;
+    frame_reclaim_cnt -= frame->reclaim;
     list_remove(&frame->elem);
+    frame->elem.prev = frame->elem.next = NULL;
+}
+
+void
+frame_page_reassign_and_remove_list(struct frame* frame)
+{
+    list_init(&frame->pages);
+    frame_unlink(frame);
 }
 
 void
@@ -179,26 +812,850 @@ frame_remove(struct frame* frame_to_remove, bool is_free_page)
     lock_acquire(&frames_lock);
     ASSERT(frame_to_remove != NULL);
 
-    if(frame_clock_points == &frame_to_remove->elem) 
-        frame_clock_points = list_next(frame_clock_points);
-
+    share_remove(frame_to_remove);
     if(is_free_page) 
         palloc_free_page(frame_to_remove->kpage);
     
-    list_remove(&frame_to_remove->elem);
+    /* Frames that failed to load were never pushed. */
+    if(frame_to_remove->elem.next != NULL)
+        frame_unlink(frame_to_remove);
     free(frame_to_remove);
 
     lock_release(&frames_lock);
 }
 
+/* Detach page from its frame and unmap it.  The frame is freed
+    once no page maps it any more. */
 void
-frame_push_back(struct frame* frame)
+frame_detach(struct page* page)
 {
-    list_push_back (&frames, &frame->elem);
+    lock_acquire(&frames_lock);
+
+    struct frame* frame = page->frame;
+    if(frame != NULL)
+    {
+        list_remove(&page->frame_elem);
+        page->frame = NULL;
+        pagedir_clear_page(page->thread->pagedir, page->upage);
+        if(frame != zero_frame)
+            rss_charge(page->thread, -1);
+
+        if(list_empty(&frame->pages) && frame != zero_frame)
+            frame_free(frame, page);
+    }
+
+    lock_release(&frames_lock);
+}
+
+/* Frees frame, which page, its last page, just left.  A frame
+    holding a page of a shared memory segment stays with the
+    segment instead, on the frames list, until a process maps the
+    page again, eviction swaps it out into the segment, or the
+    segment goes away (see frame_free_shm()). */
+static void
+frame_free(struct frame* frame, struct page* page)
+{
+    ASSERT (lock_held_by_current_thread (&frames_lock));
+
+    if(page->type == PAGE_SHM)
+        return;
+    if(frame->elem.next != NULL)
+        frame_unlink(frame);
+    share_remove(frame);
+    palloc_free_page(frame->kpage);
+    free(frame);
+}
+
+/* Detaches the cnt pages in pages, pages of the exiting current
+    process, from their frames under one acquisition of the frame
+    lock, and frees the frames no other page maps.  The pages must
+    be unmapped already; page_exit() clears the whole user range
+    of the page directory first. */
+void
+frame_release(struct page** pages, size_t cnt)
+{
+    size_t i;
+
+    lock_acquire(&frames_lock);
+    for(i = 0; i < cnt; i++)
+    {
+        struct page* page = pages[i];
+        struct frame* frame = page->frame;
+        if(frame == NULL)
+            continue;
+
+        list_remove(&page->frame_elem);
+        page->frame = NULL;
+        if(frame == zero_frame)
+            continue;
+        rss_charge(page->thread, -1);
+        if(list_empty(&frame->pages))
+            frame_free(frame, page);
+    }
+    lock_release(&frames_lock);
 }
 
-uint32_t *
-get_pagedir_of_frame(struct frame* frame)
+/* Attach page to loaded frame and push it to the clock, and
+    register it as shared if it holds a read-only file page not
+    cached yet */
+void
+frame_push_back(struct frame* frame, struct page* page)
 {
-    return frame->page->thread->pagedir;
-}
\ No newline at end of file
+    lock_acquire(&frames_lock);
+    list_push_back (&frame->pages, &page->frame_elem);
+    page->frame = frame;
+    frame_link(frame, page);
+    rss_charge(page->thread, 1);
+    if(page->type == PAGE_SHM)
+    {
+        frame->shm = page->shm;
+        frame->shm_index = SHM_INDEX(page);
+        page->shm->frames[frame->shm_index] = frame;
+    }
+
+    if(is_shareable(page) && share_find(page) == NULL)
+    {
+        frame->sector = inode_get_inumber(file_get_inode(page->file));
+        frame->ofs = page->ofs;
+        frame->read_bytes = page->read_bytes;
+        frame->shared = true;
+        hash_insert(&shared_frames, &frame->share_elem);
+    }
+    lock_release(&frames_lock);
+}
+
+/* Maps page, a page of a shared memory segment, onto the frame
+    that holds the page for its segment, whether or not another
+    process maps it.
+    If no frame holds it, return false */
+static bool
+frame_share_shm(struct page* page)
+{
+    lock_acquire(&frames_lock);
+    struct frame* frame = page->shm->frames[SHM_INDEX(page)];
+    bool success = frame != NULL
+        && pagedir_set_page(page->thread->pagedir, page->upage, frame->kpage, page->writable);
+    if(success)
+    {
+        list_push_back(&frame->pages, &page->frame_elem);
+        page->frame = frame;
+        rss_charge(page->thread, 1);
+    }
+    lock_release(&frames_lock);
+    return success;
+}
+
+/* Maps page read-only onto the frame of another process that
+    holds the same file page, or a shared memory page onto its
+    segment's frame.
+    If there is no such frame, return false */
+bool
+frame_share(struct page* page)
+{
+    if(page->type == PAGE_SHM)
+        return frame_share_shm(page);
+    if(!is_shareable(page))
+        return false;
+
+    lock_acquire(&frames_lock);
+    struct frame* frame = share_find(page);
+    bool success = frame != NULL
+        && pagedir_set_page(page->thread->pagedir, page->upage, frame->kpage, false);
+    if(success)
+    {
+        list_push_back(&frame->pages, &page->frame_elem);
+        page->frame = frame;
+        rss_charge(page->thread, 1);
+    }
+    lock_release(&frames_lock);
+    return success;
+}
+
+/* Maps page, which must read as zeros, read-only onto the zero
+    frame.  Its first write fault gives it a private frame (see
+    frame_unshare()). */
+bool
+frame_map_zero(struct page* page)
+{
+    lock_acquire(&frames_lock);
+    bool success = pagedir_set_page(page->thread->pagedir, page->upage, zero_frame->kpage, false);
+    if(success)
+    {
+        list_push_back(&zero_frame->pages, &page->frame_elem);
+        page->frame = zero_frame;
+    }
+    lock_release(&frames_lock);
+    return success;
+}
+
+/* Backs the PTSPAN / PGSIZE pages in pages, the not yet present
+    zero-fill pages of one 4 MB aligned region of the current
+    process, with a zeroed 4 MB page mapped by a single page
+    directory entry.  Each page still gets a frame of its own, so
+    that the clock sees them separately and the large page can be
+    split again when one of them is evicted or unmapped, or its
+    accessed bit is first cleared.
+    Never evicts; if no aligned 4 MB of user memory is free, or no
+    page table can be set aside for splitting it, return false */
+bool
+frame_map_large(struct page** pages)
+{
+    size_t cnt = 1 << PTBITS;
+    uint8_t* kpage = palloc_get_aligned(PAL_USER | PAL_ZERO, cnt, cnt);
+    if(kpage == NULL)
+        return false;
+
+    lock_acquire(&frames_lock);
+    size_t i;
+    for(i = 0; i < cnt; i++)
+    {
+        struct frame* frame = frame_create(kpage + i * PGSIZE);
+        if(frame == NULL)
+            break;
+        list_push_back(&frame->pages, &pages[i]->frame_elem);
+        pages[i]->frame = frame;
+    }
+    if(i < cnt)
+    {
+        /* frame_create() already freed page i. */
+        palloc_free_multiple(kpage + (i + 1) * PGSIZE, cnt - i - 1);
+        while(i-- > 0)
+        {
+            struct frame* frame = pages[i]->frame;
+            pages[i]->frame = NULL;
+            palloc_free_page(frame->kpage);
+            free(frame);
+        }
+        lock_release(&frames_lock);
+        return false;
+    }
+
+    if(!pagedir_set_large_page(thread_current()->pagedir, pages[0]->upage, kpage, true))
+    {
+        for(i = 0; i < cnt; i++)
+        {
+            free(pages[i]->frame);
+            pages[i]->frame = NULL;
+        }
+        palloc_free_multiple(kpage, cnt);
+        lock_release(&frames_lock);
+        return false;
+    }
+    for(i = 0; i < cnt; i++)
+        frame_link(pages[i]->frame, pages[i]);
+    rss_charge(thread_current(), cnt);
+    lock_release(&frames_lock);
+    return true;
+}
+
+/* Returns true if page's file page is already held by a shared
+    frame, so that loading it again would only duplicate it. */
+bool
+frame_is_shared(struct page* page)
+{
+    if(!is_shareable(page))
+        return false;
+
+    lock_acquire(&frames_lock);
+    bool found = share_find(page) != NULL;
+    lock_release(&frames_lock);
+    return found;
+}
+
+/* Makes child, a copy of parent in a forked process, share
+    parent's frame if it has one.  Private writable pages become
+    copy-on-write: both mappings are made read-only and the first
+    write fault copies the frame (see frame_unshare()).  Pages of
+    shared file mappings and shared memory stay writable in both
+    processes. */
+bool
+frame_fork(struct page* parent, struct page* child)
+{
+    bool success = true;
+
+    lock_acquire(&frames_lock);
+    struct frame* frame = parent->frame;
+    child->type = parent->type;
+    child->file = parent->file;
+    child->swap_index = parent->swap_index;     /* Or ofs. */
+    if(frame != NULL)
+    {
+        uint32_t* parent_pd = parent->thread->pagedir;
+        bool writable = parent->type == PAGE_MMAP
+            || (parent->type == PAGE_SHM && parent->writable);
+
+        if(parent->writable && !writable)
+            pagedir_set_writable(parent_pd, parent->upage, false);
+        success = pagedir_set_page(child->thread->pagedir, child->upage, frame->kpage, writable);
+        if(success)
+        {
+            /* Dirty data must survive the parent's later copy. */
+            if(pagedir_is_dirty(parent_pd, parent->upage))
+                pagedir_set_dirty(child->thread->pagedir, child->upage, true);
+            list_push_back(&frame->pages, &child->frame_elem);
+            child->frame = frame;
+            if(frame != zero_frame)
+                rss_charge(child->thread, 1);
+        }
+    }
+    else if(parent->type == PAGE_SWAP)
+        swap_dup(parent->swap_index);
+    lock_release(&frames_lock);
+
+    return success;
+}
+
+/* Resolves a write fault on page, a writable page mapped
+    read-only because its frame is shared copy-on-write or is
+    the zero frame.
+    If page is the last sharer, its mapping is made writable in
+    place; otherwise the frame is copied into new_frame, which
+    is freed if unused.  Returns false if page is no longer
+    resident (it was evicted meanwhile) */
+bool
+frame_unshare(struct page* page, struct frame* new_frame)
+{
+    lock_acquire(&frames_lock);
+
+    struct frame* frame = page->frame;
+    uint32_t* pd = page->thread->pagedir;
+    bool success = frame != NULL;
+    if(success && !needs_copy(frame))
+    {
+        merge_leave(frame);
+        pagedir_set_writable(pd, page->upage, true);
+    }
+    else if(success && new_frame != NULL)
+    {
+        if(frame == zero_frame)
+            memset(new_frame->kpage, 0, PGSIZE);
+        else
+            memcpy(new_frame->kpage, frame->kpage, PGSIZE);
+        list_remove(&page->frame_elem);
+        pagedir_clear_page(pd, page->upage);
+        success = pagedir_set_page(pd, page->upage, new_frame->kpage, true);
+        if(success)
+        {
+            pagedir_set_dirty(pd, page->upage, true);
+            list_push_back(&new_frame->pages, &page->frame_elem);
+            page->frame = new_frame;
+            frame_link(new_frame, page);
+            new_frame = NULL;
+            if(frame == zero_frame)
+                rss_charge(page->thread, 1);
+
+            /* A cached file frame whose last mapper left. */
+            if(list_empty(&frame->pages) && frame != zero_frame)
+            {
+                share_remove(frame);
+                palloc_free_page(frame->kpage);
+                frame_unlink(frame);
+                free(frame);
+            }
+        }
+        else
+        {
+            page->frame = NULL;
+            if(frame != zero_frame)
+                rss_charge(page->thread, -1);
+        }
+    }
+    else
+        success = false;
+
+    if(new_frame != NULL)
+    {
+        palloc_free_page(new_frame->kpage);
+        free(new_frame);
+    }
+    lock_release(&frames_lock);
+    return success;
+}
+
+/* Pins page's frame so that it is not evicted until
+    frame_unpin().  If write, page must also be writable in place,
+    not mapped copy-on-write or onto the zero frame.
+    If page is not resident or needs unsharing, return false */
+bool
+frame_pin(struct page* page, bool write)
+{
+    lock_acquire(&frames_lock);
+    struct frame* frame = page->frame;
+    bool success = frame != NULL;
+    if(success && write && page->type != PAGE_MMAP)
+    {
+        /* A sole copy-on-write mapper can write in place; making
+           it writable now saves a fault under the caller's locks. */
+        if(needs_copy(frame))
+            success = false;
+        else
+        {
+            merge_leave(frame);
+            pagedir_set_writable(page->thread->pagedir, page->upage, true);
+        }
+    }
+    if(success)
+        frame->pin_cnt++;
+    lock_release(&frames_lock);
+    return success;
+}
+
+/* Sets whether page may be written, for mprotect().
+    A private file page that was written becomes anonymous first,
+    so that it is swapped out rather than dropped once it is
+    read-only.  A page made writable whose frame needs copying
+    stays mapped read-only; its first write copies the frame (see
+    frame_unshare()). */
+void
+frame_set_writable(struct page* page, bool writable)
+{
+    lock_acquire(&frames_lock);
+    struct frame* frame = page->frame;
+    if(frame != NULL && !writable && page->type == PAGE_FILE && page->writable
+       && frame != zero_frame && rmap_is_dirty(frame))
+    {
+        page->type = PAGE_ZERO;
+        page->file = NULL;
+        page->ofs = 0;
+    }
+    page->writable = writable;
+    if(frame != NULL
+       && (!writable || page->type == PAGE_MMAP || !needs_copy(frame)))
+    {
+        if(writable)
+            merge_leave(frame);
+        pagedir_set_writable(page->thread->pagedir, page->upage, writable);
+    }
+    lock_release(&frames_lock);
+}
+
+/* Marks page's frame to be evicted before any other, for
+    madvise(), and clears its accessed bit so that a later use
+    shows.  If lazy_free, page is anonymous and its data may be
+    dropped instead of swapped out unless it is written first.
+    Frames shared with other pages are left alone. */
+void
+frame_deactivate(struct page* page, bool lazy_free)
+{
+    lock_acquire(&frames_lock);
+    struct frame* frame = page->frame;
+    if(frame != NULL && frame->elem.next != NULL && list_size(&frame->pages) == 1)
+    {
+        pagedir_set_accessed(page->thread->pagedir, page->upage, false);
+        if(lazy_free)
+        {
+            pagedir_set_dirty(page->thread->pagedir, page->upage, false);
+            frame->lazy_free = true;
+        }
+        if(!frame->reclaim)
+        {
+            frame->reclaim = true;
+            frame_reclaim_cnt++;
+        }
+    }
+    lock_release(&frames_lock);
+}
+
+/* Clears the dirty bits of page's frame, which the caller has
+    pinned to write it back.  Returns true if it was dirty */
+bool
+frame_clean(struct page* page)
+{
+    lock_acquire(&frames_lock);
+    ASSERT(page->frame != NULL && page->frame->pin_cnt > 0);
+    bool dirty = rmap_is_dirty(page->frame);
+    if(dirty)
+        rmap_clear_dirty(page->frame);
+    lock_release(&frames_lock);
+    return dirty;
+}
+
+/* Releases one frame_pin() of page. */
+void
+frame_unpin(struct page* page)
+{
+    lock_acquire(&frames_lock);
+    ASSERT(page->frame != NULL && page->frame->pin_cnt > 0);
+    page->frame->pin_cnt--;
+    lock_release(&frames_lock);
+}
+
+/* Returns true if page's frame must be copied before page is
+    written (see needs_copy()). */
+bool
+frame_is_cow(struct page* page)
+{
+    lock_acquire(&frames_lock);
+    bool shared = page->frame != NULL && needs_copy(page->frame);
+    lock_release(&frames_lock);
+    return shared;
+}
+
+static struct frame*
+share_find(struct page* page)
+{
+    ASSERT (lock_held_by_current_thread (&frames_lock));
+
+    struct frame key;
+    struct hash_elem* e;
+
+    key.sector = inode_get_inumber(file_get_inode(page->file));
+    key.ofs = page->ofs;
+    key.read_bytes = page->read_bytes;
+    e = hash_find(&shared_frames, &key.share_elem);
+    return e != NULL ? hash_entry(e, struct frame, share_elem) : NULL;
+}
+
+/* Takes frame out of the shared frame table and the tables of
+    same-page merging. */
+static void
+share_remove(struct frame* frame)
+{
+    ASSERT (lock_held_by_current_thread (&frames_lock));
+
+    if(frame->shared)
+    {
+        hash_delete(&shared_frames, &frame->share_elem);
+        frame->shared = false;
+    }
+    if(frame->merge != MERGE_NONE)
+    {
+        hash_delete(frame->merge == MERGE_STABLE ? &stable_frames : &unstable_frames,
+                    &frame->merge_elem);
+        frame->merge = MERGE_NONE;
+    }
+}
+
+static unsigned
+share_hash_func(const struct hash_elem *e, void *aux UNUSED)
+{
+    const struct frame *f = hash_entry(e, struct frame, share_elem);
+    return hash_int(f->sector) ^ hash_int(f->ofs);
+}
+
+static bool
+share_less_func(const struct hash_elem *e1, const struct hash_elem *e2, void *aux UNUSED)
+{
+    const struct frame *f1 = hash_entry(e1, struct frame, share_elem);
+    const struct frame *f2 = hash_entry(e2, struct frame, share_elem);
+
+    if(f1->sector != f2->sector)
+        return f1->sector < f2->sector;
+    if(f1->ofs != f2->ofs)
+        return f1->ofs < f2->ofs;
+    return f1->read_bytes < f2->read_bytes;
+}
+
+static unsigned
+merge_hash_func(const struct hash_elem *e, void *aux UNUSED)
+{
+    return hash_entry(e, struct frame, merge_elem)->checksum;
+}
+
+static bool
+merge_less_func(const struct hash_elem *e1, const struct hash_elem *e2, void *aux UNUSED)
+{
+    return hash_entry(e1, struct frame, merge_elem)->checksum
+        < hash_entry(e2, struct frame, merge_elem)->checksum;
+}
+
+/* Returns true if frame holds a single anonymous or writable
+    private file page that same-page merging may map elsewhere. */
+static bool
+is_mergeable(struct frame* frame)
+{
+    if(frame->pin_cnt > 0 || frame->shared || frame->merge != MERGE_NONE
+       || frame->lazy_free || list_size(&frame->pages) != 1)
+        return false;
+
+    struct page* page = list_entry(list_front(&frame->pages), struct page, frame_elem);
+    return page->type == PAGE_ZERO || (page->type == PAGE_FILE && page->writable);
+}
+
+/* Turns page, a private file page whose frame is merged, into an
+    anonymous page, so that the frame is swapped out rather than
+    dropped and reloaded from some other page's file. */
+static void
+make_anonymous(struct page* page)
+{
+    page->type = PAGE_ZERO;
+    page->file = NULL;
+    page->ofs = 0;
+}
+
+/* Gives the single page of frame, write-protected by the caller,
+    its own mapping back if it may be written in place. */
+static void
+write_unprotect(struct frame* frame)
+{
+    struct page* page = list_entry(list_front(&frame->pages), struct page, frame_elem);
+    if(page->writable && !needs_copy(frame))
+        pagedir_set_writable(page->thread->pagedir, page->upage, true);
+}
+
+/* Makes match, a candidate with the same checksum as frame, a
+    merged frame if their contents are still the same once both
+    are write-protected.  Otherwise returns false and leaves match
+    as it was. */
+static bool
+merge_promote(struct frame* match, struct frame* frame)
+{
+    struct list_elem* e;
+
+    if(match->pin_cnt > 0)
+        return false;
+    rmap_write_protect(match);
+    if(memcmp(match->kpage, frame->kpage, PGSIZE))
+    {
+        write_unprotect(match);
+        return false;
+    }
+
+    hash_delete(&unstable_frames, &match->merge_elem);
+    match->merge = MERGE_STABLE;
+    hash_insert(&stable_frames, &match->merge_elem);
+    match->lazy_free = false;
+    for (e = list_begin(&match->pages); e != list_end(&match->pages); e = list_next(e))
+        make_anonymous(list_entry(e, struct page, frame_elem));
+    return true;
+}
+
+/* Maps the page of frame, which is write-protected and holds the
+    same contents as the merged frame match, onto match, and frees
+    frame. */
+static void
+merge_into(struct frame* frame, struct frame* match)
+{
+    struct page* page = list_entry(list_pop_front(&frame->pages), struct page, frame_elem);
+    uint32_t* pd = page->thread->pagedir;
+
+    /* The page table is still there, so mapping cannot fail. */
+    pagedir_clear_page(pd, page->upage);
+    pagedir_set_page(pd, page->upage, match->kpage, false);
+    make_anonymous(page);
+    list_push_back(&match->pages, &page->frame_elem);
+    page->frame = match;
+    merge_cnt++;
+
+    frame_unlink(frame);
+    palloc_free_page(frame->kpage);
+    free(frame);
+}
+
+/* Scans frame for same-page merging.  Its checksum must be the
+    same as at the last scan, which passes over frames being
+    written.  It is then merged onto a frame with the same
+    contents, or becomes a candidate for later frames. */
+static void
+merge_frame(struct frame* frame)
+{
+    struct frame* match = NULL;
+    struct hash_elem* e;
+
+    if(!is_mergeable(frame))
+        return;
+    merge_scan_cnt++;
+
+    unsigned checksum = hash_bytes(frame->kpage, PGSIZE);
+    if(checksum != frame->checksum)
+    {
+        frame->checksum = checksum;
+        return;
+    }
+
+    rmap_write_protect(frame);
+    e = hash_find(&stable_frames, &frame->merge_elem);
+    if(e != NULL)
+    {
+        match = hash_entry(e, struct frame, merge_elem);
+        if(memcmp(match->kpage, frame->kpage, PGSIZE))
+            match = NULL;
+    }
+    else
+    {
+        e = hash_find(&unstable_frames, &frame->merge_elem);
+        if(e != NULL)
+        {
+            match = hash_entry(e, struct frame, merge_elem);
+            if(!merge_promote(match, frame))
+                match = NULL;
+        }
+        else
+        {
+            frame->merge = MERGE_UNSTABLE;
+            hash_insert(&unstable_frames, &frame->merge_elem);
+        }
+    }
+
+    if(match != NULL)
+        merge_into(frame, match);
+    else
+        write_unprotect(frame);
+}
+
+/* Takes frame out of stable_frames if it is merged, because the
+    last page left on it is about to be written in place. */
+static void
+merge_leave(struct frame* frame)
+{
+    if(frame->merge == MERGE_STABLE)
+    {
+        hash_delete(&stable_frames, &frame->merge_elem);
+        frame->merge = MERGE_NONE;
+    }
+}
+
+static void
+merge_forget(struct hash_elem *e, void *aux UNUSED)
+{
+    hash_entry(e, struct frame, merge_elem)->merge = MERGE_NONE;
+}
+
+/* Scans the next cnt frames on the frames list for same-page
+    merging, going round to the front after the back.  Candidates
+    are forgotten at the start of each pass. */
+void
+frame_merge_scan(size_t cnt)
+{
+    lock_acquire(&frames_lock);
+    for(; cnt > 0 && !list_empty(&frames); cnt--)
+    {
+        if(is_tail(merge_hand) || is_back(merge_hand))
+            hash_clear(&unstable_frames, merge_forget);
+        merge_hand = hand_forward(merge_hand);
+        merge_frame(list_entry(merge_hand, struct frame, elem));
+    }
+    lock_release(&frames_lock);
+}
+
+/* Idle page tracking.  Each call of frame_idle_scan() tests and
+   clears the accessed bits of every frame, through all of its
+   mappers, and counts in frame->idle the scans in a row that found
+   none set.  A use the scan clears is kept in frame->young for the
+   eviction policy, which would otherwise never see it.  Frames left
+   idle for reclaim_age scans are evicted at once, ahead of any
+   shortage of memory. */
+void
+frame_idle_scan(size_t reclaim_age)
+{
+    struct list_elem* e;
+    struct list_elem* next;
+
+    lock_acquire(&frames_lock);
+    idle_scan_cnt++;
+    for(e = list_begin(&frames); e != list_end(&frames); e = next)
+    {
+        struct frame* frame = list_entry(e, struct frame, elem);
+        bool young = frame->young;
+
+        next = list_next(e);
+        frame->young = false;
+        if(rmap_test_and_clear_accessed(frame) || frame->pin_cnt > 0)
+        {
+            frame->young = true;
+            frame->idle = 0;
+            continue;
+        }
+        frame->young = young;
+        if(frame->idle < UINT8_MAX)
+            frame->idle++;
+
+        if(reclaim_age > 0 && frame->idle >= reclaim_age)
+        {
+            if(!frame_evict(frame))
+                break;
+            idle_reclaim_cnt++;
+            frame_unlink(frame);
+            palloc_free_page(frame->kpage);
+            free(frame);
+        }
+    }
+    lock_release(&frames_lock);
+}
+
+/* Fills in *wss for the current process from the idle counts of
+    the frames its resident pages map.  Pages on the zero frame
+    hold no memory of their own and are skipped, as rss_charge()
+    skips them. */
+void
+frame_get_wss(struct wss* wss)
+{
+    uint8_t* upage = NULL;
+    struct page* page;
+
+    memset(wss, 0, sizeof *wss);
+    lock_acquire(&frames_lock);
+    wss->scans = idle_scan_cnt;
+    while((page = page_next_resident(upage)) != NULL
+          && (uint8_t*) page->upage >= upage)
+    {
+        int bucket = 0;
+        unsigned idle;
+
+        upage = (uint8_t*) page->upage + PGSIZE;
+        if(page->frame != zero_frame)
+        {
+            for(idle = page->frame->idle; idle > 0; idle /= 2)
+                bucket++;
+            wss->resident++;
+            wss->idle[bucket]++;
+        }
+        if(upage == PHYS_BASE)
+            break;
+    }
+    lock_release(&frames_lock);
+}
+
+/* Frees the frames that still hold pages of shm, a segment being
+    destroyed, which no page maps any more.  Eviction may move
+    them into swap up to the moment the frame lock is taken. */
+void
+frame_free_shm(struct shm* shm)
+{
+    size_t i;
+
+    lock_acquire(&frames_lock);
+    for(i = 0; i < shm->page_cnt; i++)
+    {
+        struct frame* frame = shm->frames[i];
+        if(frame == NULL)
+            continue;
+        ASSERT(list_empty(&frame->pages));
+        frame_unlink(frame);
+        palloc_free_page(frame->kpage);
+        free(frame);
+        shm->frames[i] = NULL;
+    }
+    lock_release(&frames_lock);
+}
+
+void
+frame_print_stats(void)
+{
+    struct hash_iterator i;
+    size_t merged = 0, sharing = 0;
+
+    printf("Frame: %lld evicted by %s (%lld dirty), %lld written back early, "
+           "%lld by RSS limits\n",
+           evict_cnt, policy->name, evict_dirty_cnt, writeback_cnt, evict_local_cnt);
+
+    hash_first(&i, &stable_frames);
+    while(hash_next(&i))
+    {
+        merged++;
+        sharing += list_size(&hash_entry(hash_cur(&i), struct frame, merge_elem)->pages);
+    }
+    printf("Frame: %lld scanned for merging, %lld pages merged; %zu frames shared "
+           "by %zu pages, %zu kB saved\n",
+           merge_scan_cnt, merge_cnt, merged, sharing, (sharing - merged) * PGSIZE / 1024);
+    printf("Frame: %lld scans for idle pages, %lld idle pages reclaimed\n",
+           idle_scan_cnt, idle_reclaim_cnt);
+}
+
+/* Returns the number of frames holding user pages. */
+size_t
+frame_resident_cnt(void)
+{
+    return frame_cnt;
+}
+
@@ -2,26 +2,88 @@
 #define VM_FRAME_H
 
 #include <stdbool.h>
+#include <hash.h>
+#include "lib/user/syscall.h"
 #include "threads/synch.h"
 #include "vm/page.h"
 
+struct shm;
+
 struct frame
     {
         void *kpage;
-        struct page* page;
+        struct list pages;          /* Reverse map: pages mapping this frame. */
         struct list_elem elem;
+
+        /* Shared read-only file frames. */
+        bool shared;                /* In the shared frame table? */
+        struct hash_elem share_elem;
+        block_sector_t sector;      /* Inode sector of the file. */
+        off_t ofs;                  /* Offset of the page in the file. */
+        uint32_t read_bytes;
+
+        /* Same-page merging (see frame_merge_scan()). */
+        uint8_t merge;              /* MERGE_NONE, _UNSTABLE or _STABLE. */
+        unsigned checksum;          /* Contents at the last scan. */
+        struct hash_elem merge_elem;
+
+        /* Shared memory: the segment whose page this is, which the
+           frame stays with while no process maps it. */
+        struct shm* shm;            /* Owning segment, or NULL. */
+        size_t shm_index;           /* Page number in the segment. */
+
+        /* Idle page tracking (see frame_idle_scan()). */
+        uint8_t idle;               /* Scans since a mapper last used it. */
+        bool young;                 /* Used, unseen by the eviction policy? */
+
+        bool hot;                   /* In 2Q's main queue? */
+        bool reclaim;               /* Evict before other frames? */
+        bool lazy_free;             /* Drop instead of swapping if clean? */
+        int pin_cnt;                /* Pinned for kernel I/O if nonzero. */
     };
 
+/* Where a frame stands in same-page merging. */
+enum merge_state
+    {
+        MERGE_NONE,         /* Not a candidate. */
+        MERGE_UNSTABLE,     /* Candidate, still writable. */
+        MERGE_STABLE        /* Read-only, shared by identical pages. */
+    };
+
+/* Distance between the hands of the two-handed clock policy. */
+extern size_t frame_hand_spread;
+
 void frame_init (void);
-struct frame* frame_allocate(struct page* page);
-void frame_push_back(struct frame* frame);
+struct frame* frame_allocate(void);
+struct frame* frame_try_allocate(void);
+void frame_push_back(struct frame* frame, struct page* page);
 void frame_remove(struct frame* frame, bool is_free_page);
-void frame_page_reassign_and_remove_list(struct frame* f, struct page* p);
+void frame_detach(struct page* page);
+void frame_release(struct page** pages, size_t cnt);
+bool frame_share(struct page* page);
+bool frame_map_zero(struct page* page);
+bool frame_map_large(struct page** pages);
+bool frame_is_shared(struct page* page);
+bool frame_fork(struct page* parent, struct page* child);
+bool frame_unshare(struct page* page, struct frame* new_frame);
+bool frame_is_cow(struct page* page);
+bool frame_pin(struct page* page, bool write);
+void frame_unpin(struct page* page);
+void frame_set_writable(struct page* page, bool writable);
+void frame_deactivate(struct page* page, bool lazy_free);
+bool frame_clean(struct page* page);
+void frame_page_reassign_and_remove_list(struct frame* f);
 bool frame_evict(struct frame* frame);
 struct frame* frame_to_evict(void);
-struct frame* frame_evict_and_reassign(struct page* page);
-uint32_t* get_pagedir_of_frame(struct frame* frame);
-bool swap_frame(struct page* page, struct frame* frame);
+bool frame_set_policy(const char* name);
+struct frame* frame_evict_and_reassign(void);
+bool swap_frame(struct frame* frame);
 struct frame* frame_clock_forward(void);
+size_t frame_resident_cnt(void);
+void frame_merge_scan(size_t cnt);
+void frame_idle_scan(size_t reclaim_age);
+void frame_get_wss(struct wss* wss);
+void frame_print_stats(void);
+void frame_free_shm(struct shm* shm);
 
 #endif
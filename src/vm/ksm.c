@@ -0,0 +1,33 @@
+#include "vm/ksm.h"
+#include "devices/timer.h"
+#include "threads/thread.h"
+#include "vm/frame.h"
+
+/* Frames the merging thread scans every KSM_INTERVAL, or 0 if it
+   does not run.  Set with the -ksm=N kernel option. */
+size_t ksm_scan_rate;
+
+/* Ticks between scans. */
+#define KSM_INTERVAL (TIMER_FREQ / 10)
+
+static thread_func ksm_thread;
+
+/* Starts the thread that merges identical pages, if enabled. */
+void
+ksm_init(void)
+{
+    if(ksm_scan_rate > 0)
+        thread_create("ksm", PRI_DEFAULT, ksm_thread, NULL);
+}
+
+/* Scans ksm_scan_rate frames for same-page merging every
+    KSM_INTERVAL ticks (see frame_merge_scan()). */
+static void
+ksm_thread(void* aux UNUSED)
+{
+    for(;;)
+    {
+        timer_sleep(KSM_INTERVAL);
+        frame_merge_scan(ksm_scan_rate);
+    }
+}
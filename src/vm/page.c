@@ -1,38 +1,161 @@
 #include "vm/page.h"
-#include <hash.h>
 #include <stdio.h>
 #include <bitmap.h>
+#include <stdlib.h>
+#include <string.h>
+#include "threads/malloc.h"
+#include "vm/faultstat.h"
 #include "vm/frame.h"
+#include "vm/shm.h"
 #include "vm/swap.h"
+#include "vm/vma.h"
+#include "vm/vmstat.h"
 #include "threads/thread.h"
 #include "userprog/pagedir.h"
+#include "userprog/syscall.h"
+#include "threads/init.h"
 #include "threads/vaddr.h"
+#include "threads/palloc.h"
 #include "filesys/file.h"
+#include "filesys/inode.h"
 
+/* Largest fault-around window page_load_around() will use. */
+#define FAULT_AROUND_MAX 16
+
+/* Number of pages, including the faulting one, that a read fault
+   on a file-backed page tries to map from a single file read.
+   Set with the -fault-around=N kernel option; 1 disables it. */
+size_t page_fault_around = 8;
+
+/* Most pages page_preload() reads with one file_read_at(). */
+#define PRELOAD_MAX 32
+
+/* Largest data segment, in pages, that load() maps at exec time
+   instead of a page per fault; code segments are mapped whatever
+   their size.  Set with the -eager-load=N kernel option; 0 loads
+   every segment lazily. */
+size_t page_eager_load = 16;
+
+/* Largest stack growth window page_grow_stack() will use. */
+#define STACK_WINDOW_MAX 32
+
+/* Number of stack pages, including the faulting one, that a
+   stack growth fault reserves and maps.  Set with the
+   -stack-window=N kernel option; 1 grows the stack a page per
+   fault. */
+size_t page_stack_window = 4;
+
+/* Back 4 MB aligned regions of zero-fill pages with 4 MB pages,
+   if the CPU has them.  Set with the -large-pages kernel option. */
+bool page_large_pages;
+
+/* Number of pages mapped ahead of demand by fault-around. */
+static long long page_around_cnt;
+
+/* Number of read faults served by the shared zero frame. */
+static long long page_zero_cnt;
+
+/* Number of 4 MB pages mapped. */
+static long long page_large_cnt;
+
+/* Number of pages read in by MADV_WILLNEED. */
+static long long page_prefetch_cnt;
+
+/* Number of executable pages mapped at exec time. */
+static long long page_preload_cnt;
+
+/* Number of stack growth faults, and of the stack pages they
+   mapped ahead of use. */
+static long long page_stack_cnt;
+static long long page_stack_ahead_cnt;
+
+/* Number of file mapping pages page_write_back() wrote, and the
+   writes it took. */
+static long long page_writeback_cnt;
+static long long page_writeback_io_cnt;
+
+static bool page_map(struct page* p, struct frame* f);
+static bool page_fill(struct page* p, struct frame* f);
+static void drop_behind(struct vma* v, uint8_t* upage);
+static void write_run(struct page** run, size_t cnt);
+static bool page_load_large(struct page* p);
+static bool page_load_shm(struct page* p);
+static bool stack_prefault(void* upage);
+static bool is_zero_fill(struct page* p);
+static bool is_around_candidate(struct page* p, struct page* q, int delta);
+static bool page_load_batch(struct page** batch, struct frame** frames, size_t cnt);
+
+/* Calls ACTION on each page of PT in address order, stopping
+   when it returns false.  Returns false if it stopped early. */
+typedef bool page_action_func(struct page* p, void* aux);
+
+static bool
+page_table_apply(struct page_table* pt, page_action_func* action, void* aux)
+{
+    uintptr_t pde;
+    unsigned pte;
+
+    for (pde = 0; pde < pd_no(PHYS_BASE); pde++)
+        if (pt->leaves[pde] != NULL)
+            for (pte = 0; pte < 1 << PTBITS; pte++)
+            {
+                struct page* p = pt->leaves[pde][pte];
+                if (p != NULL && !action(p, aux))
+                    return false;
+            }
+    return true;
+}
+
+/* Creates an empty supplemental page table.
+    If failed, return NULL */
+struct page_table*
+page_table_create(void)
+{
+    ASSERT (sizeof (struct page_table) == PGSIZE);
+    return palloc_get_page(PAL_ZERO);
+}
+
+/* Adds P to the current thread's page table, allocating its leaf
+    if needed.  If failed, frees P and return false */
+static bool
+page_insert(struct page* p)
+{
+    struct page** *leaf = &thread_current()->pages->leaves[pd_no(p->upage)];
+
+    if (*leaf == NULL && (*leaf = palloc_get_page(PAL_ZERO)) == NULL)
+    {
+        free(p);
+        return false;
+    }
+    (*leaf)[pt_no(p->upage)] = p;
+    return true;
+}
+
+/* Pages with no file data become PAGE_ZERO pages; they are
+   anonymous like the stack. */
 bool
 page_create_with_file(
     void* upage, struct file* file, off_t ofs, uint32_t read_bytes, 
     uint32_t zero_bytes, bool writable, bool is_mmap)
 {
+    ASSERT(read_bytes + zero_bytes == PGSIZE);
     if(page_find_by_upage(upage) != NULL)
         return false;
 
     struct page* new_page = malloc(sizeof(struct page));
     if(new_page != NULL)
     {
+        bool is_zero = read_bytes == 0 && !is_mmap;
         new_page->upage = upage;
-        new_page->file = file;
-        new_page->ofs = ofs;
+        new_page->file = is_zero ? NULL : file;
+        new_page->ofs = is_zero ? 0 : ofs;
         new_page->read_bytes = read_bytes;
-        new_page->zero_bytes = zero_bytes;
         new_page->writable = writable;
-        new_page->swap_index = BITMAP_ERROR;
         new_page->thread = thread_current();
         new_page->frame = NULL;
-        new_page->type = is_mmap ? PAGE_MMAP : PAGE_FILE;
+        new_page->type = is_zero ? PAGE_ZERO : is_mmap ? PAGE_MMAP : PAGE_FILE;
 
-        hash_insert(thread_current()->pages, &new_page->elem);
-        return true;
+        return page_insert(new_page);
     }
     else
     {
@@ -53,15 +176,12 @@ page_create_with_zero(void *upage)
         new_page->file = NULL;
         new_page->ofs = 0;
         new_page->read_bytes = 0;
-        new_page->zero_bytes = PGSIZE;
         new_page->writable = true;
-        new_page->swap_index = BITMAP_ERROR;
         new_page->thread = thread_current();
         new_page->frame = NULL;
         new_page->type = PAGE_ZERO;
 
-        hash_insert(thread_current()->pages, &new_page->elem);
-        return true;
+        return page_insert(new_page);
     }
     else
     {
@@ -69,118 +189,910 @@ page_create_with_zero(void *upage)
     }
 }
 
+/* Creates a page at UPAGE for the page at byte offset OFS of the
+   shared memory segment SHM.  The area that maps the segment
+   holds a reference to it for the page. */
+bool
+page_create_with_shm(void* upage, struct shm* shm, off_t ofs, bool writable)
+{
+    if(page_find_by_upage(upage) != NULL)
+        return false;
+
+    struct page* new_page = malloc(sizeof(struct page));
+    if(new_page == NULL)
+        return false;
+    new_page->upage = upage;
+    new_page->shm = shm;
+    new_page->ofs = ofs;
+    new_page->read_bytes = 0;
+    new_page->writable = writable;
+    new_page->thread = thread_current();
+    new_page->frame = NULL;
+    new_page->type = PAGE_SHM;
+    return page_insert(new_page);
+}
+
+/* Gives the current thread a stack page at UADDR if UADDR is not
+   mapped yet but is a plausible stack access for stack pointer
+   ESP: within STACK_MAX of the top of user memory, and no more
+   than 32 bytes below ESP, as far as PUSHA writes.
+   Up to page_stack_window - 1 more stack pages are reserved and
+   mapped with free frames, so that deep recursion does not fault
+   on every page.  They are taken below the new page, where the
+   stack grows next, unless the page above is missing too: then
+   ESP jumped over several pages at once, with SUB or PUSHA, and
+   the new stack frame is used upward from UADDR, so the gap is
+   filled instead.  Nothing is reserved beyond STACK_MAX. */
+bool
+page_grow_stack(const void *uaddr, const void *esp)
+{
+    uint8_t* upage = pg_round_down(uaddr);
+    uint8_t* bottom = (uint8_t*) PHYS_BASE - STACK_MAX;
+    size_t window = page_stack_window < STACK_WINDOW_MAX ? page_stack_window : STACK_WINDOW_MAX;
+    size_t i;
+
+    if ((uintptr_t) uaddr + 32 < (uintptr_t) esp || upage < bottom
+        || !page_create_with_zero(upage))
+        return false;
+    page_stack_cnt++;
+
+    bool jumped = upage + PGSIZE < (uint8_t*) PHYS_BASE
+        && page_find_by_upage(upage + PGSIZE) == NULL;
+    for (i = 1; i < window; i++)
+    {
+        uint8_t* q = jumped ? upage + i * PGSIZE : upage - i * PGSIZE;
+        if (q < bottom || q >= (uint8_t*) PHYS_BASE || page_find_by_upage(q) != NULL
+            || !page_create_with_zero(q) || !stack_prefault(q))
+            break;
+    }
+    return true;
+}
+
+/* Maps the new stack page at UPAGE ahead of use.  Like
+   fault-around, it only takes a free frame and is mapped with its
+   accessed bit clear.
+   Returns false once no free frame is left */
+static bool
+stack_prefault(void* upage)
+{
+    struct page* p = page_find_by_upage(upage);
+    struct frame* f = frame_try_allocate();
+    if (f == NULL)
+        return false;
+    if (!page_fill(p, f) || !page_map(p, f))
+    {
+        frame_remove(f, true);
+        return false;
+    }
+    page_stack_ahead_cnt++;
+    return true;
+}
+
 bool
 page_load(void *upage)
 {
     struct page* page_to_load = page_find_by_upage(upage);
     if (page_to_load == NULL || page_to_load->frame != NULL)
         return false;
+    if (page_to_load->type == PAGE_SHM)
+        return page_load_shm(page_to_load);
+    if (page_load_large(page_to_load))
+        return true;
+
+    /* Code pages another process already loaded are shared. */
+    int phase = faultstat_phase(FAULT_MAP);
+    bool shared = frame_share(page_to_load);
+    faultstat_phase(phase);
+    if (shared)
+        return true;
     
-    struct frame* new_frame = frame_allocate(page_to_load);
+    struct frame* new_frame = frame_allocate();
     if(new_frame == NULL)
         return false;
     
+    if(!page_fill(page_to_load, new_frame) || !page_map(page_to_load, new_frame))
+    {
+        frame_remove(new_frame, true);
+        return false;
+    }
+    return true;
+}
+
+/* Loads P, a page of a shared memory segment, onto the frame that
+   holds the page for other processes, or into a new frame that
+   they will share.  The segment's lock keeps other processes from
+   loading the same page meanwhile. */
+static bool
+page_load_shm(struct page* p)
+{
+    struct lock* lock = &p->shm->lock;
+    bool success = true;
+
+    lock_acquire(lock);
+    int phase = faultstat_phase(FAULT_MAP);
+    bool shared = frame_share(p);
+    faultstat_phase(phase);
+    if (!shared)
+    {
+        struct frame* f = frame_allocate();
+        success = f != NULL;
+        if (success && (!page_fill(p, f) || !page_map(p, f)))
+        {
+            frame_remove(f, true);
+            success = false;
+        }
+    }
+    lock_release(lock);
+    return success;
+}
+
+/* Reads the page at UPAGE in ahead of use, for MADV_WILLNEED,
+   if it is not present.  Like fault-around, it only takes a free
+   frame and is mapped with its accessed bit clear.  Zero-fill
+   pages are left to fault onto the zero frame.
+   Returns false once no free frame is left */
+bool
+page_prefetch(void *upage)
+{
+    struct page* p = page_find_by_upage(upage);
+    if (p == NULL || p->frame != NULL || is_zero_fill(p) || p->type == PAGE_SHM
+        || frame_share(p))
+        return true;
+
+    struct frame* f = frame_try_allocate();
+    if (f == NULL)
+        return false;
+    if (!page_fill(p, f) || !page_map(p, f))
+        frame_remove(f, true);
+    else
+        page_prefetch_cnt++;
+    return true;
+}
+
+/* Reads CNT frames' worth of pages into FRAMES[] and maps them for
+   the file-backed pages in BATCH[], consecutive in memory and
+   file, with one file_read_at().  Frames that cannot be used are
+   freed.  Returns the number of pages mapped. */
+static size_t
+preload_run(struct page** batch, struct frame** frames, size_t cnt)
+{
+    size_t mapped = 0, i;
+
+    if (!page_load_batch(batch, frames, cnt))
+    {
+        for (i = 0; i < cnt; i++)
+            frame_remove(frames[i], true);
+        return 0;
+    }
+    for (i = 0; i < cnt; i++)
+        if (page_map(batch[i], frames[i]))
+            mapped++;
+        else
+            frame_remove(frames[i], true);
+    return mapped;
+}
+
+/* Maps the CNT pages from UPAGE, the file-backed pages of one
+   segment of the executable, at exec time.  Pages another process
+   already loaded are shared; the others are read up to
+   PRELOAD_MAX at a time with one file_read_at() each.  Like
+   fault-around, only free frames are taken: once none is left,
+   or the process reaches its RSS limit, the rest are left to
+   fault in as usual. */
+void
+page_preload(uint8_t* upage, size_t cnt)
+{
+    struct page* batch[PRELOAD_MAX];
+    struct frame* frames[PRELOAD_MAX];
+    bool out_of_frames = false;
+    size_t n = 0, i;
+
+    for (i = 0; i < cnt && !out_of_frames; i++)
+    {
+        struct page* p = page_find_by_upage(upage + i * PGSIZE);
+        bool take = p != NULL && p->frame == NULL && p->type == PAGE_FILE
+            && p->read_bytes > 0 && !frame_share(p);
+
+        if (take)
+        {
+            frames[n] = frame_try_allocate();
+            if (frames[n] == NULL)
+                out_of_frames = true;
+            else
+                batch[n++] = p;
+        }
+
+        /* A run ends at a page it does not take, at a partial page,
+           which must be the last of the data, or when full. */
+        if (n > 0 && (!take || out_of_frames || p->read_bytes != (uint32_t) PGSIZE
+                      || n == PRELOAD_MAX || i + 1 == cnt))
+        {
+            page_preload_cnt += preload_run(batch, frames, n);
+            n = 0;
+        }
+    }
+}
+
+/* Lets the anonymous page at UPAGE lose its data, for MADV_FREE.
+   A swapped out page gives up its slot and reads as zeros again
+   at once; a resident one is evicted before other frames and
+   then dropped, unless it is written first. */
+void
+page_free_lazily(void *upage)
+{
+    struct page* p = page_find_by_upage(upage);
+    if (p == NULL)
+        return;
+    if (p->type == PAGE_SWAP)
+    {
+        swap_remove(p->swap_index);
+        p->type = PAGE_ZERO;
+        p->ofs = 0;
+    }
+    else if (p->type == PAGE_ZERO && p->frame != NULL)
+        frame_deactivate(p, true);
+}
+
+/* Loads the page at UPAGE like page_load(), but if it is backed
+   by a file also maps up to page_fault_around - 1 neighbouring
+   pages of the same mapping that are not yet present, reading
+   all of them with one file_read_at().  The window is aligned to
+   page_fault_around pages.  Neighbours only take free frames;
+   nothing is evicted to make room for them.
+   Pages that only hold zeros are mapped read-only onto the zero
+   frame instead; they get a frame on their first write.
+   In areas advised MADV_RANDOM only the page itself is read.  In
+   MADV_SEQUENTIAL ones the window is the largest, starts at the
+   page, and the pages a window behind are marked for eviction. */
+bool
+page_load_around(void *upage)
+{
+    struct page* p = page_find_by_upage(upage);
+    if (p == NULL || p->frame != NULL)
+        return false;
+
+    struct vma* v = vma_find(upage);
+    int advice = v != NULL ? v->advice : MADV_NORMAL;
+    if (advice == MADV_SEQUENTIAL)
+        drop_behind(v, upage);
+
+    if (page_load_large(p))
+        return true;
+    int phase = faultstat_phase(FAULT_MAP);
+    bool zero = is_zero_fill(p) && frame_map_zero(p);
+    faultstat_phase(phase);
+    if (zero)
+    {
+        page_zero_cnt++;
+        return true;
+    }
+
+    size_t window = page_fault_around < FAULT_AROUND_MAX ? page_fault_around : FAULT_AROUND_MAX;
+    if (advice == MADV_RANDOM)
+        window = 1;
+    else if (advice == MADV_SEQUENTIAL)
+        window = FAULT_AROUND_MAX;
+    if (window <= 1 || (p->type != PAGE_FILE && p->type != PAGE_MMAP) || p->read_bytes == 0
+        || frame_is_shared(p))
+        return page_load(upage);
+
+    uintptr_t start = (uintptr_t) upage / (window * PGSIZE) * (window * PGSIZE);
+    if (advice == MADV_SEQUENTIAL)
+        start = (uintptr_t) upage;
+    uintptr_t end = start + window * PGSIZE;
+    struct page* batch[FAULT_AROUND_MAX];
+    struct frame* frames[FAULT_AROUND_MAX];
+    size_t before = 0, after = 0;
+
+    /* Pages before P must be full so that the data is contiguous
+       in the file; P itself then ends the leading part. */
+    while ((uintptr_t) upage - start > before * PGSIZE)
+    {
+        struct page* q = page_find_by_upage(upage - (before + 1) * PGSIZE);
+        if (!is_around_candidate(p, q, -(int) (before + 1)) || q->read_bytes != (uint32_t) PGSIZE)
+            break;
+        before++;
+    }
+    if (p->read_bytes == (uint32_t) PGSIZE)
+        while (end - (uintptr_t) upage > (after + 1) * PGSIZE)
+        {
+            struct page* q = page_find_by_upage(upage + (after + 1) * PGSIZE);
+            if (!is_around_candidate(p, q, after + 1))
+                break;
+            after++;
+            if (q->read_bytes != (uint32_t) PGSIZE)
+                break;
+        }
+
+    if (before == 0 && after == 0)
+        return page_load(upage);
+
+    /* The faulting page may evict; the others only use free frames
+       and the window shrinks to what could be allocated. */
+    frames[before] = frame_allocate();
+    if (frames[before] == NULL)
+        return false;
+    batch[before] = p;
+
+    size_t i;
+    for (i = 1; i <= before; i++)
+    {
+        batch[before - i] = page_find_by_upage(upage - i * PGSIZE);
+        frames[before - i] = frame_try_allocate();
+        if (frames[before - i] == NULL)
+            break;
+    }
+    size_t first = before - i + 1;
+    for (i = 1; i <= after; i++)
+    {
+        batch[before + i] = page_find_by_upage(upage + i * PGSIZE);
+        frames[before + i] = frame_try_allocate();
+        if (frames[before + i] == NULL)
+            break;
+    }
+    size_t cnt = before + i - first;
+
+    phase = faultstat_phase(FAULT_IO);
+    bool loaded = page_load_batch(batch + first, frames + first, cnt);
+    faultstat_phase(phase);
+    if (!loaded)
+    {
+        for (i = first; i < first + cnt; i++)
+            frame_remove(frames[i], true);
+        return false;
+    }
+
+    /* Neighbours are mapped with their accessed bits clear, so the
+       clock reclaims them first if they turn out to be unused. */
+    for (i = first; i < first + cnt; i++)
+    {
+        if (batch[i] == p)
+            continue;
+        if (page_map(batch[i], frames[i]))
+            page_around_cnt++;
+        else
+            frame_remove(frames[i], true);
+    }
+    if (!page_map(p, frames[before]))
+    {
+        frame_remove(frames[before], true);
+        return false;
+    }
+    return true;
+}
+
+/* Loads P together with the rest of its 4 MB aligned region into
+   one 4 MB page, if large pages are enabled and every page of the
+   region is a writable zero-fill page that is not present yet.
+   The region is split into 4 kB pages again as soon as one of
+   them is evicted, unmapped or shared by fork(), or the clock or
+   idle page tracking first clears its accessed bit: the 4 MB page
+   only has one, so its pages could not be aged apart.  Large
+   pages therefore pay off between eviction scans, not across
+   them. */
+static bool
+page_load_large(struct page* p)
+{
+    struct page** leaf = thread_current()->pages->leaves[pd_no(p->upage)];
+    size_t i;
+
+    if (!page_large_pages || !pse_enabled || !is_zero_fill(p))
+        return false;
+    for (i = 0; i < 1 << PTBITS; i++)
+        if (leaf[i] == NULL || !is_zero_fill(leaf[i]) || !leaf[i]->writable
+            || leaf[i]->frame != NULL)
+            return false;
+    if (!frame_map_large(leaf))
+        return false;
+    page_large_cnt++;
+    return true;
+}
+
+/* Marks the resident pages of area V from two windows up to one
+   window below UPAGE for early eviction: a sequential reader has
+   passed them and will not be back. */
+static void
+drop_behind(struct vma* v, uint8_t* upage)
+{
+    size_t behind = (upage - v->start) / PGSIZE;
+    uint8_t* q;
+
+    if (behind <= FAULT_AROUND_MAX)
+        return;
+    q = behind >= 2 * FAULT_AROUND_MAX ? upage - 2 * FAULT_AROUND_MAX * PGSIZE : v->start;
+    for (; q < upage - FAULT_AROUND_MAX * PGSIZE; q += PGSIZE)
+    {
+        struct page* b = page_find_by_upage(q);
+        if (b != NULL && b->frame != NULL)
+            frame_deactivate(b, false);
+    }
+}
+
+/* Returns true if loading P, which is not resident, reads its
+   file or swap slot: its data is neither zeros nor in a frame that
+   another process already loaded. */
+bool
+page_is_major(struct page* p)
+{
+    switch (p->type)
+    {
+    case PAGE_SWAP:
+        return true;
+    case PAGE_FILE:
+    case PAGE_MMAP:
+        return p->read_bytes > 0 && !frame_is_shared(p);
+    case PAGE_SHM:
+        return p->shm->frames[SHM_INDEX(p)] == NULL
+            && p->shm->slots[SHM_INDEX(p)] != BITMAP_ERROR;
+    default:
+        return false;
+    }
+}
+
+/* Returns true if P reads as zeros until it is first written:
+   anonymous pages that were never swapped out. */
+static bool
+is_zero_fill(struct page* p)
+{
+    return p->type == PAGE_ZERO;
+}
+
+/* Returns true if Q, DELTA pages away from P, can be read along
+   with P: same not-yet-present mapping, contiguous in the file. */
+static bool
+is_around_candidate(struct page* p, struct page* q, int delta)
+{
+    return q != NULL && q->frame == NULL && q->type == p->type
+        && q->file == p->file && q->writable == p->writable
+        && q->read_bytes > 0 && q->ofs == p->ofs + delta * (off_t) PGSIZE
+        && !frame_is_shared(q);
+}
+
+/* Fills FRAMES[] with the contents of the CNT file-backed pages
+   in BATCH[], which are consecutive in both memory and file.
+   The data is read with one file_read_at() into a bounce buffer;
+   if none can be had, the pages are read one at a time. */
+static bool
+page_load_batch(struct page** batch, struct frame** frames, size_t cnt)
+{
+    size_t i;
+    if (cnt == 1)
+        return page_load_with_file(frames[0], batch[0]);
+
+    uint8_t* buffer = palloc_get_multiple(0, cnt);
+    if (buffer == NULL)
+    {
+        for (i = 0; i < cnt; i++)
+            if (!page_load_with_file(frames[i], batch[i]))
+                return false;
+        return true;
+    }
+
+    off_t length = (cnt - 1) * PGSIZE + batch[cnt - 1]->read_bytes;
+    lock_acquire(&filesys_lock);
+    bool success = file_read_at(batch[0]->file, buffer, length, batch[0]->ofs) == length;
+    lock_release(&filesys_lock);
+    if (success)
+        for (i = 0; i < cnt; i++)
+        {
+            memcpy(frames[i]->kpage, buffer + i * PGSIZE, batch[i]->read_bytes);
+            memset(frames[i]->kpage + batch[i]->read_bytes, 0, PGSIZE - batch[i]->read_bytes);
+        }
+    palloc_free_multiple(buffer, cnt);
+    return success;
+}
+
+/* Fills frame F with the contents of page P from its file or
+   swap slot, or with zeros. */
+static bool
+page_fill(struct page* p, struct frame* f)
+{
+    int phase = faultstat_phase(FAULT_IO);
     bool success;
-    switch (page_to_load->type)
+    switch (p->type)
     {
     case PAGE_SWAP:
-        page_to_load->type = page_to_load->prev_type;
-        success = swap_in(new_frame->kpage, page_to_load->swap_index);
+        /* Its data no longer matches any file, so the page stays
+           anonymous and goes back to swap when evicted. */
+        success = swap_in(f->kpage, p->swap_index);
+        if (success)
+        {
+            VMSTAT_ADD(p->thread, swap_ins, 1);
+            p->type = PAGE_ZERO;
+            p->ofs = 0;
+        }
         break;
     
     case PAGE_FILE:
     case PAGE_MMAP:
-        success = page_load_with_file(new_frame, page_to_load);
+        success = page_load_with_file(f, p);
         break;
     
     case PAGE_ZERO:
-        success = memset(new_frame->kpage, 0, PGSIZE) != NULL;
+        success = memset(f->kpage, 0, PGSIZE) != NULL;
+        break;
+
+    case PAGE_SHM:
+        success = shm_fill(p, f->kpage);
         break;
 
     default:
         NOT_REACHED();
         break;
     }
-    
-    if(!success || !pagedir_set_page(thread_current ()->pagedir, upage, new_frame->kpage, page_to_load->writable))
+    faultstat_phase(phase);
+    return success;
+}
+
+/* Maps freshly loaded frame F for page P and makes it visible to
+   the clock. */
+static bool
+page_map(struct page* p, struct frame* f)
+{
+    int phase = faultstat_phase(FAULT_MAP);
+    bool success = pagedir_set_page(p->thread->pagedir, p->upage, f->kpage, p->writable);
+    if (success)
+        frame_push_back(f, p); //After init, push
+    faultstat_phase(phase);
+    return success;
+}
+
+bool
+page_load_with_file(struct frame* f,struct page* p)
+{
+    lock_acquire(&filesys_lock);
+    bool success = file_read_at(p->file, f->kpage, p->read_bytes, p->ofs) == (int) p->read_bytes;
+    lock_release(&filesys_lock);
+    if (!success)
+        return false;
+    memset(f->kpage + p->read_bytes, 0, PGSIZE - p->read_bytes);
+    return true;
+}
+
+/* Orders pages by file, then by offset in it. */
+static int
+compare_file_ofs(const void* a_, const void* b_, void* aux UNUSED)
+{
+    const struct page* a = *(struct page* const*) a_;
+    const struct page* b = *(struct page* const*) b_;
+    block_sector_t a_inode = inode_get_inumber(file_get_inode(a->file));
+    block_sector_t b_inode = inode_get_inumber(file_get_inode(b->file));
+
+    if (a_inode != b_inode)
+        return a_inode < b_inode ? -1 : 1;
+    return a->ofs < b->ofs ? -1 : a->ofs > b->ofs;
+}
+
+/* Writes the dirty ones among the CNT shared file mapping pages
+   in PAGES back to their files.  The caller has pinned them.
+   They are sorted by file and offset, and runs of pages that are
+   contiguous in one file go out with one file_write_at() of up
+   to FAULT_AROUND_MAX pages.  Only the file's bytes of a page are
+   written, so the file never grows. */
+void
+page_write_back(struct page** pages, size_t cnt)
+{
+    struct page* run[FAULT_AROUND_MAX];
+    size_t run_cnt = 0;
+    size_t i;
+
+    sort(pages, cnt, sizeof *pages, compare_file_ofs, NULL);
+    for (i = 0; i < cnt; i++)
     {
-        frame_remove(new_frame, true);
+        struct page* p = pages[i];
+        ASSERT (p->type == PAGE_MMAP);
+        if (p->read_bytes == 0 || !frame_clean(p))
+            continue;
+
+        if (run_cnt > 0)
+        {
+            struct page* last = run[run_cnt - 1];
+            if (run_cnt == FAULT_AROUND_MAX || last->read_bytes != (uint32_t) PGSIZE
+                || last->ofs + PGSIZE != p->ofs
+                || file_get_inode(last->file) != file_get_inode(p->file))
+            {
+                write_run(run, run_cnt);
+                run_cnt = 0;
+            }
+        }
+        run[run_cnt++] = p;
+    }
+    if (run_cnt > 0)
+        write_run(run, run_cnt);
+}
+
+/* Writes the CNT pages in RUN, consecutive in one file, with one
+   write through a bounce buffer, or one by one if none can be
+   had. */
+static void
+write_run(struct page** run, size_t cnt)
+{
+    uint8_t* buffer = cnt > 1 ? palloc_get_multiple(0, cnt) : NULL;
+    size_t i;
+
+    page_writeback_cnt += cnt;
+    for (i = 0; i < cnt; i++)
+        VMSTAT_ADD(run[i]->thread, writebacks, 1);
+    if (buffer == NULL)
+    {
+        for (i = 0; i < cnt; i++)
+            mmap_file_write_at(run[i]->file, run[i]->frame->kpage, run[i]->read_bytes,
+                               run[i]->ofs);
+        page_writeback_io_cnt += cnt;
+        return;
+    }
+
+    for (i = 0; i < cnt; i++)
+        memcpy(buffer + i * PGSIZE, run[i]->frame->kpage, run[i]->read_bytes);
+    mmap_file_write_at(run[0]->file, buffer, (cnt - 1) * PGSIZE + run[cnt - 1]->read_bytes,
+                       run[0]->ofs);
+    page_writeback_io_cnt++;
+    palloc_free_multiple(buffer, cnt);
+}
+
+/* Resolves a write fault on the present but read-only page at
+   UPAGE.  Succeeds only for writable pages whose frame is shared
+   copy-on-write after fork() or is the zero frame; the page gets
+   a private copy. */
+bool
+page_unshare(void *upage)
+{
+    struct page* p = page_find_by_upage(upage);
+    if (p == NULL || !p->writable)
         return false;
+    if (p->frame == NULL)
+        return page_load(upage);
+
+    /* Only allocate when the frame is still shared, then let
+       frame_unshare() decide under the frame lock. */
+    struct frame* new_frame = NULL;
+    if (frame_is_cow(p))
+    {
+        new_frame = frame_allocate();
+        if (new_frame == NULL)
+            return false;
     }
+    int phase = faultstat_phase(FAULT_MAP);
+    bool unshared = frame_unshare(p, new_frame);
+    faultstat_phase(phase);
+    if (unshared)
+        return true;
+    return p->frame == NULL && page_load(upage);
+}
 
-    page_to_load->frame = new_frame;
-    frame_push_back(page_to_load->frame); //After init, push
+static bool
+fork_page(struct page* p, void* aux UNUSED)
+{
+    struct page* new_page = malloc(sizeof(struct page));
+    if (new_page == NULL)
+        return false;
+
+    *new_page = *p;
+    new_page->thread = thread_current();
+    new_page->frame = NULL;
+    if (!page_insert(new_page))
+        return false;
+
+    /* Residency may change under eviction until the frame lock is
+       held, so take the copy again there. */
+    return frame_fork(p, new_page);
+}
+
+/* Makes the page holding UADDR resident and pins it, for writing
+   if WRITE.  Stack pages are created on demand. */
+static bool
+page_pin(const void *uaddr, bool write)
+{
+    void* upage = pg_round_down(uaddr);
+    struct page* p = page_find_by_upage(upage);
+
+    if (p == NULL && page_grow_stack(uaddr, thread_current()->user_esp))
+        p = page_find_by_upage(upage);
+    if (p == NULL || (write && !p->writable))
+        return false;
+
+    /* Eviction may take the page again before it is pinned. */
+    while (!frame_pin(p, write))
+        if (p->frame == NULL ? !page_load(upage) : !page_unshare(upage))
+            return false;
     return true;
 }
 
+/* Faults in and pins the pages covering [UADDR, UADDR + SIZE), so
+   that the kernel can access them without page faults while it
+   holds locks the fault path needs, such as filesys_lock.  Pages
+   are made writable if WRITE.
+   If any page is bad, pins nothing and return false */
 bool
-page_load_with_file(struct frame* f,struct page* p)
+page_pin_range(const void *uaddr, size_t size, bool write)
 {
-    if (file_read_at(p->file, f->kpage, p->read_bytes, p->ofs) != (int) p->read_bytes)
-    {
-        frame_remove(f, true);
+    const void* addr;
+
+    if (uaddr == NULL || (uintptr_t) uaddr + size < (uintptr_t) uaddr
+        || (uintptr_t) uaddr + size > (uintptr_t) PHYS_BASE)
         return false;
-    }
-    memset(f->kpage + p->read_bytes, 0, p->zero_bytes);
+
+    for (addr = uaddr; addr < uaddr + size; addr = pg_round_down(addr) + PGSIZE)
+        if (!page_pin(addr, write))
+        {
+            page_unpin_range(uaddr, addr - uaddr);
+            return false;
+        }
     return true;
 }
 
+/* Unpins the pages pinned by page_pin_range(UADDR, SIZE). */
 void
-page_exit(void)
+page_unpin_range(const void *uaddr, size_t size)
+{
+    const void* addr;
+
+    for (addr = uaddr; addr < uaddr + size; addr = pg_round_down(addr) + PGSIZE)
+        frame_unpin(page_find_by_upage(pg_round_down(addr)));
+}
+
+/* Copies the supplemental page table of PARENT into the current
+   thread, a process forked from it.  Resident frames and swap
+   slots are shared rather than copied. */
+bool
+page_fork(struct thread *parent)
 {
-    struct hash* h = thread_current()->pages;
-    if(h != NULL)
-        hash_destroy(h, page_destory);
+    return page_table_apply(parent->pages, fork_page, NULL);
 }
 
+static bool
+rebind_page(struct page* p, void* aux)
+{
+    struct file** files = aux;
+    if (p->file == files[0])
+        p->file = files[1];
+    return true;
+}
+
+/* Points the current thread's pages backed by OLD_FILE at
+   NEW_FILE instead.  After fork() the child's pages must refer to
+   its own reopened files. */
 void
-page_destory (struct hash_elem *e, void *aux UNUSED)
+page_rebind_file(struct file* old_file, struct file* new_file)
 {
-    struct page* p = hash_entry(e, struct page, elem);
-    if(p->frame)
-        frame_remove(p->frame, false);
-    if(p->swap_index != BITMAP_ERROR) 
-        swap_remove(p->swap_index);
-    free(p);
+    struct file* files[2] = {old_file, new_file};
+    page_table_apply(thread_current()->pages, rebind_page, files);
 }
 
-struct page*
-page_find_by_upage(void* upage)
+/* Prints page loading statistics. */
+void
+page_print_stats(void)
 {
-    struct page page_to_find;
-    struct hash_elem *e;
+    printf("Page: %lld pages mapped by fault-around, %lld onto the zero page, "
+           "%lld 4 MB pages, %lld prefetched, %lld at exec\n",
+           page_around_cnt, page_zero_cnt, page_large_cnt, page_prefetch_cnt,
+           page_preload_cnt);
+    printf("Page: %lld file mapping pages written back in %lld writes\n",
+           page_writeback_cnt, page_writeback_io_cnt);
+    printf("Page: %lld stack growth faults, %lld stack pages mapped ahead\n",
+           page_stack_cnt, page_stack_ahead_cnt);
+}
 
-    page_to_find.upage = upage;
-    e = hash_find (thread_current()->pages, &page_to_find.elem);
-    if(e != NULL)
-        return hash_entry(e, struct page, elem);
-    else
-        return NULL;
+/* Pages page_exit() releases at a time.  Each batch takes the
+   frame and swap locks once; bounding it keeps other processes'
+   faults from waiting behind a whole address space. */
+#define EXIT_BATCH 64
+
+struct exit_batch
+    {
+        struct page* pages[EXIT_BATCH];
+        size_t cnt;
+    };
+
+/* Releases the frames and swap slots of the pages in b, then
+    frees the pages.  Their types are only read once they are off
+    their frames, where eviction can no longer swap them out. */
+static void
+release_pages(struct exit_batch* b)
+{
+    size_t slots[EXIT_BATCH];
+    size_t slot_cnt = 0, i;
+
+    frame_release(b->pages, b->cnt);
+    for(i = 0; i < b->cnt; i++)
+    {
+        if(b->pages[i]->type == PAGE_SWAP)
+            slots[slot_cnt++] = b->pages[i]->swap_index;
+        free(b->pages[i]);
+    }
+    swap_release(slots, slot_cnt);
+    b->cnt = 0;
 }
 
+static bool
+exit_page(struct page* p, void* aux)
+{
+    struct exit_batch* b = aux;
+
+    b->pages[b->cnt++] = p;
+    if(b->cnt == EXIT_BATCH)
+        release_pages(b);
+    return true;
+}
+
+/* Destroys the current process's pages in one walk of its page
+    table, releasing their frames and swap slots EXIT_BATCH at a
+    time.  The whole user range is unmapped first, with one TLB
+    flush, so that no PTE points at a frame after it is freed;
+    pagedir_destroy() then leaves the frames to us. */
 void
-page_destory_by_upage (void* upage, bool is_free_page)
+page_exit(void)
+{
+    struct page_table* pt = thread_current()->pages;
+    struct exit_batch batch;
+    uintptr_t pde;
+
+    if(pt == NULL)
+        return;
+
+    if(thread_current()->pagedir != NULL)
+        pagedir_clear_range(thread_current()->pagedir, NULL, PHYS_BASE);
+    batch.cnt = 0;
+    page_table_apply(pt, exit_page, &batch);
+    release_pages(&batch);
+    for (pde = 0; pde < pd_no(PHYS_BASE); pde++)
+        if (pt->leaves[pde] != NULL)
+            palloc_free_page(pt->leaves[pde]);
+    palloc_free_page(pt);
+    thread_current()->pages = NULL;
+}
+
+void
+page_destory (struct page* p)
 {
-    struct page* p = page_find_by_upage(upage);
     if(p->frame)
-        frame_remove(p->frame, is_free_page);
-    if(p->swap_index != BITMAP_ERROR) 
+        frame_detach(p);
+    if(p->type == PAGE_SWAP) 
         swap_remove(p->swap_index);
     free(p);
 }
 
-unsigned
-page_hash_func (const struct hash_elem *e, void *aux UNUSED)
+/* Returns the current process's first resident page at or above
+   UPAGE, going round to the bottom of user memory after the top,
+   or NULL if none of its pages is resident.  Used as the hand of
+   the clock that reclaims a process's own pages. */
+struct page*
+page_next_resident(const void* upage)
 {
-  const struct page *p = hash_entry (e, struct page, elem);
-  return hash_bytes (&p->upage, sizeof p->upage);
+    struct page_table* pt = thread_current()->pages;
+    size_t first = pg_no(upage) < pg_no(PHYS_BASE) ? pg_no(upage) : 0;
+    size_t cnt = pg_no(PHYS_BASE), i;
+
+    for (i = 0; i < cnt; i++)
+    {
+        void* va = (void*) (((first + i) % cnt) << PGBITS);
+        struct page** leaf = pt->leaves[pd_no(va)];
+        if (leaf == NULL)
+        {
+            /* Skip the rest of the missing leaf. */
+            i += (1 << PTBITS) - 1 - pt_no(va);
+            continue;
+        }
+        if (leaf[pt_no(va)] != NULL && leaf[pt_no(va)]->frame != NULL)
+            return leaf[pt_no(va)];
+    }
+    return NULL;
 }
 
-bool
-page_less_func(const struct hash_elem *e1, const struct hash_elem *e2,void *aux UNUSED)
+/* Two lookups, like the MMU's walk of the page directory. */
+struct page*
+page_find_by_upage(void* upage)
 {
-  const struct page *p1 = hash_entry (e1, struct page, elem);
-  const struct page *p2 = hash_entry (e2, struct page, elem);
+    struct page** leaf = thread_current()->pages->leaves[pd_no(upage)];
+    return leaf != NULL ? leaf[pt_no(upage)] : NULL;
+}
 
-  return p1->upage < p2->upage;
-}
\ No newline at end of file
+void
+page_destory_by_upage (void* upage)
+{
+    struct page* p = page_find_by_upage(upage);
+    if(p == NULL)
+        return;
+    thread_current()->pages->leaves[pd_no(upage)][pt_no(upage)] = NULL;
+    page_destory(p);
+}
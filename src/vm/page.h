@@ -1,49 +1,87 @@
 #ifndef VM_PAGE_H
 #define VM_PAGE_H
 
-#include <hash.h>
+#include <list.h>
 #include "devices/block.h"
 #include "filesys/off_t.h"
+#include "threads/pte.h"
 #include "threads/synch.h"
 
 enum page_type
   {
-    PAGE_ZERO,          
-    PAGE_FILE,
-    PAGE_MMAP,
-    PAGE_SWAP
+    PAGE_ZERO,          /* Anonymous: zeros until first swapped out. */
+    PAGE_FILE,          /* Private copy of a file page. */
+    PAGE_MMAP,          /* Shared file mapping page. */
+    PAGE_SWAP,          /* Anonymous page in a swap slot. */
+    PAGE_SHM            /* Page of a shared memory segment. */
   };
 
+struct shm;
+
+/* Largest size the user stack may grow to. */
+#define STACK_MAX (8 * 1024 * 1024)
+
+/* Supplemental page table entry.  Kept to 32 bytes, the smallest
+   malloc() block it fits in. */
 struct page 
     {
         struct thread* thread;
-        struct hash_elem elem; 
+        void* upage;
 
         struct frame* frame;
-        void* upage;
+        struct list_elem frame_elem;    /* Element in frame's pages. */
         
-        size_t swap_index;
-        
-        struct file* file;
+        union
+            {
+                struct file* file;      /* PAGE_FILE and PAGE_MMAP only. */
+                struct shm* shm;        /* PAGE_SHM only. */
+            };
+        union
+            {
+                off_t ofs;              /* Offset of the page in file or segment. */
+                size_t swap_index;      /* Slot of a PAGE_SWAP page. */
+            };
+        uint16_t read_bytes;            /* Rest of the page is zeroed. */
+        uint8_t type;                   /* enum page_type. */
         bool writable;
-        uint32_t read_bytes;
-        uint32_t zero_bytes;
-        off_t ofs;
+    };
 
-        enum page_type type;
-        enum page_type prev_type;
+/* Supplemental page table.  A two-level radix tree split like
+   the page directory: a page of pointers to leaves indexed by
+   pd_no(), each a page of pointers to pages indexed by pt_no(). */
+struct page_table
+    {
+        struct page** leaves[1 << PDBITS];
     };
 
 bool page_create_with_file(void* upage, struct file* file, off_t ofs, uint32_t read_bytes,  uint32_t zero_bytes, bool writable, bool is_mmap);
 bool page_create_with_zero(void *upage);
+bool page_create_with_shm(void* upage, struct shm* shm, off_t ofs, bool writable);
+bool page_grow_stack(const void *uaddr, const void *esp);
+void page_preload(uint8_t* upage, size_t cnt);
 bool page_load(void *upage);
+bool page_load_around(void *upage);
+bool page_prefetch(void *upage);
+void page_free_lazily(void *upage);
+void page_write_back(struct page** pages, size_t cnt);
+struct page* page_next_resident(const void* upage);
+bool page_is_major(struct page* p);
 void page_exit(void);
-void page_destory(struct hash_elem *e, void *aux);
+void page_destory(struct page* p);
+struct page_table* page_table_create(void);
 struct page* page_find_by_upage(void* upage);
 bool page_load_with_file(struct frame* f,struct page* p);
-void page_destory_by_upage (void* upage, bool);
-    
-hash_hash_func page_hash_func;
-hash_less_func page_less_func;
+void page_destory_by_upage (void* upage);
+bool page_unshare(void *upage);
+bool page_pin_range(const void *uaddr, size_t size, bool write);
+void page_unpin_range(const void *uaddr, size_t size);
+bool page_fork(struct thread *parent);
+void page_rebind_file(struct file* old_file, struct file* new_file);
+void page_print_stats(void);
+
+extern size_t page_fault_around;
+extern bool page_large_pages;
+extern size_t page_stack_window;
+extern size_t page_eager_load;
 
 #endif
\ No newline at end of file
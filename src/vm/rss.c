@@ -0,0 +1,164 @@
+#include "vm/rss.h"
+#include <debug.h>
+#include "threads/malloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "userprog/process.h"
+
+/* Hard limit of processes started from the kernel command line,
+   in pages, 0 for none.  Set with the -rss-limit=N option. */
+size_t rss_default_limit;
+
+/* Protects the counts and limits of processes and groups.  Taken
+   inside the frame lock, which every charge is made under. */
+static struct lock rss_lock;
+
+static void group_put(struct mem_group* g);
+
+void
+rss_init(void)
+{
+    lock_init(&rss_lock);
+}
+
+/* Sets up the accounting of pcb, a new process started by
+    parent, which is NULL for the first process.  The child starts
+    with no resident pages and inherits parent's limits and
+    group. */
+void
+rss_init_process(struct process* pcb, struct process* parent)
+{
+    pcb->rss = 0;
+    pcb->rss_hand = NULL;
+    if(parent == NULL)
+    {
+        pcb->rss_soft = 0;
+        pcb->rss_hard = rss_default_limit;
+        pcb->group = NULL;
+        return;
+    }
+
+    lock_acquire(&rss_lock);
+    pcb->rss_soft = parent->rss_soft;
+    pcb->rss_hard = parent->rss_hard;
+    pcb->group = parent->group;
+    if(pcb->group != NULL)
+        pcb->group->ref_cnt++;
+    lock_release(&rss_lock);
+}
+
+/* Takes pcb, whose pages are all gone, out of its group. */
+void
+rss_exit(struct process* pcb)
+{
+    lock_acquire(&rss_lock);
+    ASSERT(pcb->rss == 0);
+    group_put(pcb->group);
+    pcb->group = NULL;
+    lock_release(&rss_lock);
+}
+
+/* Adds cnt, which may be negative, to the resident pages of t's
+    process and its groups.  Threads without a process own no
+    pages. */
+void
+rss_charge(struct thread* t, int cnt)
+{
+    struct process* pcb = t->pcb;
+    struct mem_group* g;
+
+    if(pcb == NULL)
+        return;
+    lock_acquire(&rss_lock);
+    pcb->rss += cnt;
+    for(g = pcb->group; g != NULL; g = g->parent)
+        g->usage += cnt;
+    lock_release(&rss_lock);
+}
+
+/* Returns how t's process stands against the limits of its own
+    and of its groups.  A process at a hard limit replaces its own
+    pages rather than grow; one over a soft limit does so only
+    when no frame is free. */
+enum rss_state
+rss_get_state(struct thread* t)
+{
+    struct process* pcb = t->pcb;
+    enum rss_state state = RSS_UNDER;
+    struct mem_group* g;
+
+    if(pcb == NULL)
+        return RSS_UNDER;
+    lock_acquire(&rss_lock);
+    if(pcb->rss_hard != 0 && pcb->rss >= pcb->rss_hard)
+        state = RSS_HARD;
+    else if(pcb->rss_soft != 0 && pcb->rss > pcb->rss_soft)
+        state = RSS_SOFT;
+    for(g = pcb->group; g != NULL && state != RSS_HARD; g = g->parent)
+        if(g->hard != 0 && g->usage >= g->hard)
+            state = RSS_HARD;
+        else if(g->soft != 0 && g->usage > g->soft)
+            state = RSS_SOFT;
+    lock_release(&rss_lock);
+    return state;
+}
+
+/* Sets the current process's limits, in pages, 0 for none.
+    If soft is above hard, return false */
+bool
+rss_set_limits(size_t soft, size_t hard)
+{
+    struct process* pcb = thread_current()->pcb;
+
+    if(hard != 0 && soft > hard)
+        return false;
+    lock_acquire(&rss_lock);
+    pcb->rss_soft = soft;
+    pcb->rss_hard = hard;
+    lock_release(&rss_lock);
+    return true;
+}
+
+/* Starts a group inside the current process's group with limits
+    soft and hard, in pages, 0 for none, and moves the process
+    into it.  Children started from now on join it too.
+    If soft is above hard or memory runs out, return false */
+bool
+rss_enter_group(size_t soft, size_t hard)
+{
+    struct process* pcb = thread_current()->pcb;
+    struct mem_group* g;
+
+    if(hard != 0 && soft > hard)
+        return false;
+    g = malloc(sizeof *g);
+    if(g == NULL)
+        return false;
+    g->soft = soft;
+    g->hard = hard;
+    g->ref_cnt = 1;
+
+    /* The process's reference to its old group passes to the new
+       one, whose usage the old group already counts. */
+    lock_acquire(&rss_lock);
+    g->parent = pcb->group;
+    g->usage = pcb->rss;
+    pcb->group = g;
+    lock_release(&rss_lock);
+    return true;
+}
+
+/* Drops a reference to g, freeing it and dropping its reference
+    to its parent with the last. */
+static void
+group_put(struct mem_group* g)
+{
+    ASSERT(lock_held_by_current_thread(&rss_lock));
+    while(g != NULL && --g->ref_cnt == 0)
+    {
+        struct mem_group* parent = g->parent;
+        ASSERT(g->usage == 0);
+        free(g);
+        g = parent;
+    }
+}
@@ -0,0 +1,40 @@
+#ifndef VM_RSS_H
+#define VM_RSS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+struct process;
+struct thread;
+
+/* Memory group: processes whose resident pages are limited
+   together.  Groups nest, and a page charged to a process counts
+   against its group and every group above it. */
+struct mem_group
+    {
+        struct mem_group* parent;   /* Enclosing group, or NULL. */
+        size_t usage;               /* Resident pages of the members. */
+        size_t soft;                /* Soft limit in pages, 0 if none. */
+        size_t hard;                /* Hard limit in pages, 0 if none. */
+        int ref_cnt;                /* Member processes and subgroups. */
+    };
+
+/* Where a process stands against its limits and its groups'. */
+enum rss_state
+    {
+        RSS_UNDER,          /* Within all limits. */
+        RSS_SOFT,           /* Over a soft limit. */
+        RSS_HARD            /* At a hard limit. */
+    };
+
+void rss_init(void);
+void rss_init_process(struct process* pcb, struct process* parent);
+void rss_exit(struct process* pcb);
+void rss_charge(struct thread* t, int cnt);
+enum rss_state rss_get_state(struct thread* t);
+bool rss_set_limits(size_t soft, size_t hard);
+bool rss_enter_group(size_t soft, size_t hard);
+
+extern size_t rss_default_limit;
+
+#endif
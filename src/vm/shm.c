@@ -0,0 +1,179 @@
+#include "vm/shm.h"
+#include <bitmap.h>
+#include <round.h>
+#include <string.h>
+#include "threads/malloc.h"
+#include "threads/vaddr.h"
+#include "userprog/process.h"
+#include "vm/frame.h"
+#include "vm/swap.h"
+
+/* Linked segments, and the lock that protects the list and every
+   segment's name and reference count. */
+static struct list names;
+static struct lock shm_lock;
+
+void
+shm_init(void)
+{
+    list_init(&names);
+    lock_init(&shm_lock);
+}
+
+/* Creates an unnamed segment of size bytes, rounded up to whole
+    pages, reading as zeros, with one reference.
+    If size is 0 or memory runs out, return NULL */
+struct shm*
+shm_create(size_t size)
+{
+    size_t page_cnt = DIV_ROUND_UP(size, PGSIZE), i;
+    struct shm* shm;
+
+    if(page_cnt == 0 || size > (size_t) PHYS_BASE)
+        return NULL;
+    shm = malloc(sizeof *shm);
+    if(shm == NULL)
+        return NULL;
+    shm->frames = calloc(page_cnt, sizeof *shm->frames);
+    shm->slots = malloc(page_cnt * sizeof *shm->slots);
+    if(shm->frames == NULL || shm->slots == NULL)
+    {
+        free(shm->frames);
+        free(shm->slots);
+        free(shm);
+        return NULL;
+    }
+    for(i = 0; i < page_cnt; i++)
+        shm->slots[i] = BITMAP_ERROR;
+    shm->name[0] = '\0';
+    shm->linked = false;
+    shm->ref_cnt = 1;
+    shm->page_cnt = page_cnt;
+    lock_init(&shm->lock);
+    return shm;
+}
+
+/* Returns the linked segment called name, or NULL. */
+static struct shm*
+find(const char* name)
+{
+    struct list_elem* e;
+
+    ASSERT(lock_held_by_current_thread(&shm_lock));
+    for(e = list_begin(&names); e != list_end(&names); e = list_next(e))
+    {
+        struct shm* shm = list_entry(e, struct shm, elem);
+        if(!strcmp(shm->name, name))
+            return shm;
+    }
+    return NULL;
+}
+
+/* Returns a new reference to the segment called name, for
+    shm_open().  With SHM_CREAT in flags a missing segment is
+    created, size bytes long; size is ignored otherwise.  With
+    SHM_CREAT and SHM_EXCL the segment must not exist yet.
+    If that fails or memory runs out, return NULL */
+struct shm*
+shm_lookup(const char* name, int flags, size_t size)
+{
+    struct shm* shm;
+
+    lock_acquire(&shm_lock);
+    shm = find(name);
+    if(shm != NULL)
+    {
+        if((flags & SHM_CREAT) && (flags & SHM_EXCL))
+            shm = NULL;
+        else
+            shm->ref_cnt++;
+    }
+    else if((flags & SHM_CREAT) && (shm = shm_create(size)) != NULL)
+    {
+        strlcpy(shm->name, name, sizeof shm->name);
+        shm->linked = true;
+        list_push_back(&names, &shm->elem);
+    }
+    lock_release(&shm_lock);
+    return shm;
+}
+
+/* Removes the name of the segment called name, for shm_unlink().
+    The segment lasts until its last descriptor is closed and its
+    last area unmapped.  If there is no such segment, return
+    false */
+bool
+shm_remove(const char* name)
+{
+    struct shm* shm;
+
+    lock_acquire(&shm_lock);
+    shm = find(name);
+    if(shm != NULL)
+    {
+        list_remove(&shm->elem);
+        shm->linked = false;
+    }
+    lock_release(&shm_lock);
+    if(shm != NULL)
+    {
+        /* Take a reference so that shm_put() frees it if unused. */
+        shm_dup(shm);
+        shm_put(shm);
+    }
+    return shm != NULL;
+}
+
+/* Adds a reference to shm. */
+void
+shm_dup(struct shm* shm)
+{
+    lock_acquire(&shm_lock);
+    shm->ref_cnt++;
+    lock_release(&shm_lock);
+}
+
+/* Drops a reference to shm, freeing it with the last once it is
+    unlinked.  No page maps it by then; its frames are freed under
+    the frame lock first, so that eviction stops moving pages into
+    slots before the slots are freed. */
+void
+shm_put(struct shm* shm)
+{
+    bool dead;
+    size_t i;
+
+    lock_acquire(&shm_lock);
+    dead = --shm->ref_cnt == 0 && !shm->linked;
+    lock_release(&shm_lock);
+    if(!dead)
+        return;
+
+    frame_free_shm(shm);
+    for(i = 0; i < shm->page_cnt; i++)
+        if(shm->slots[i] != BITMAP_ERROR)
+            swap_remove(shm->slots[i]);
+    free(shm->frames);
+    free(shm->slots);
+    free(shm);
+}
+
+/* Fills kpage with the data of page, a PAGE_SHM page that no frame
+    holds: zeros, or the contents of its swap slot, which is freed.
+    Call with the segment's lock held. */
+bool
+shm_fill(struct page* page, void* kpage)
+{
+    size_t* slot = &page->shm->slots[SHM_INDEX(page)];
+
+    ASSERT(lock_held_by_current_thread(&page->shm->lock));
+    if(*slot == BITMAP_ERROR)
+    {
+        memset(kpage, 0, PGSIZE);
+        return true;
+    }
+    if(!swap_in(kpage, *slot))
+        return false;
+    *slot = BITMAP_ERROR;
+    return true;
+}
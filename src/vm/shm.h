@@ -0,0 +1,48 @@
+#ifndef VM_SHM_H
+#define VM_SHM_H
+
+#include <list.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "filesys/directory.h"
+#include "threads/synch.h"
+#include "vm/page.h"
+
+/* Shared memory segment: anonymous pages shared by every process
+   that maps them, named by shm_open() or, for
+   mmap2(MAP_SHARED | MAP_ANONYMOUS), unnamed and shared through
+   fork().  Each page of the segment lives in one frame, which the
+   PAGE_SHM pages of all its mappers share through the reverse map
+   and eviction swaps out for all of them at once, or in a swap
+   slot the segment keeps, or nowhere yet, reading as zeros.  A
+   frame whose last mapper leaves stays with the segment, still on
+   the frames list, so that the page is found there if it is
+   mapped again and eviction can still swap it out. */
+struct shm
+    {
+        char name[NAME_MAX + 1];    /* Name, while linked. */
+        struct list_elem elem;      /* In the list of names, while linked. */
+        bool linked;                /* Can still be opened by name? */
+        int ref_cnt;                /* Descriptors and areas using it. */
+        size_t page_cnt;            /* Size in pages. */
+
+        /* Loaders of the segment's pages hold lock, so that each
+           page is read from its slot once; eviction changes the
+           arrays under the frame lock. */
+        struct lock lock;
+        struct frame** frames;      /* Frame holding each page, or NULL. */
+        size_t* slots;              /* Swap slot of each page, or BITMAP_ERROR. */
+    };
+
+/* Index of P, a PAGE_SHM page, in its segment. */
+#define SHM_INDEX(P) ((size_t) (P)->ofs / PGSIZE)
+
+void shm_init(void);
+struct shm* shm_create(size_t size);
+struct shm* shm_lookup(const char* name, int flags, size_t size);
+bool shm_remove(const char* name);
+void shm_dup(struct shm* shm);
+void shm_put(struct shm* shm);
+bool shm_fill(struct page* page, void* kpage);
+
+#endif
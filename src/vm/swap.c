@@ -1,28 +1,180 @@
 #include "vm/swap.h"
 #include <bitmap.h>
 #include <debug.h>
+#include <random.h>
+#include <round.h>
+#include <stdio.h>
+#include <stdlib.h>
 #include "vm/frame.h"
 #include "vm/page.h"
+#include "vm/zswap.h"
+#include "devices/timer.h"
+#include "threads/palloc.h"
 #include "threads/vaddr.h"
+#include "threads/malloc.h"
 #include "threads/synch.h"
 
 static struct block *swap_block_device;
 
-static struct bitmap *swap_bitmap;
+/* Slots are allocated in clusters of SWAP_CLUSTER.  swap_bitmap
+   marks each free slot, and above it cluster_bitmap marks the
+   clusters with any free slot, so allocation skips full clusters
+   without looking at their slots and then scans a single
+   cluster.  Allocation stays in one cluster until it fills, so
+   on average a cluster is found once per SWAP_CLUSTER slots.
+
+   Each slot has a count of the pages sharing it: forked
+   processes and merged pages share the slots of swapped-out
+   pages instead of copying them.  The counts are allocated per
+   cluster, only while the cluster has a slot in use, so a large
+   swap device that is mostly empty costs little kernel memory. */
+#define SWAP_CLUSTER 256
+
+static struct bitmap *swap_bitmap;      /* Free slots. */
+static struct bitmap *cluster_bitmap;   /* Clusters with free slots. */
+static uint16_t *cluster_free;          /* Free slots in each cluster. */
+static uint16_t **cluster_refs;         /* Slot counts, or NULL if all free. */
+static size_t slot_cnt, cluster_cnt;
+static size_t free_cnt;                 /* Free slots in all. */
+static size_t cluster_hint;             /* Cluster to allocate from. */
+
+/* Boot option: measure the slot allocator after swap_init(). */
+bool swap_run_bench;
 
 static struct lock swap_lock;
 
+/* Page that pages spilled from the compressed cache are
+   decompressed into before being written to disk. */
+static void *swap_spill_page;
+
+/* Statistics: pages swapped in from each tier, and the cycles it
+   took. */
+static long long cache_in_cnt, cache_in_cycles;
+static long long disk_in_cnt, disk_in_cycles;
+static long long swap_out_cnt;
+
 #define NUM_SECTORS_PER_PAGE (PGSIZE / BLOCK_SECTOR_SIZE)
 
+static void swap_write(size_t swap_index, const void *kpage);
+static void swap_bench(void);
+
 void
 swap_init(void)
 {
+    size_t c;
+
     swap_block_device = block_get_role(BLOCK_SWAP);
     ASSERT(swap_block_device != NULL);
-    swap_bitmap = bitmap_create(block_size(swap_block_device) / NUM_SECTORS_PER_PAGE);
-    ASSERT(swap_bitmap != NULL);
+    slot_cnt = block_size(swap_block_device) / NUM_SECTORS_PER_PAGE;
+    cluster_cnt = DIV_ROUND_UP(slot_cnt, SWAP_CLUSTER);
+    swap_bitmap = bitmap_create(slot_cnt);
+    cluster_bitmap = bitmap_create(cluster_cnt);
+    cluster_free = malloc(cluster_cnt * sizeof *cluster_free);
+    cluster_refs = calloc(cluster_cnt, sizeof *cluster_refs);
+    ASSERT(swap_bitmap != NULL && cluster_bitmap != NULL);
+    ASSERT(cluster_cnt == 0 || (cluster_free != NULL && cluster_refs != NULL));
     bitmap_set_all (swap_bitmap, true);
+    bitmap_set_all (cluster_bitmap, true);
+    for(c = 0; c < cluster_cnt; c++)
+        cluster_free[c] = c + 1 < cluster_cnt ? SWAP_CLUSTER
+                                              : slot_cnt - c * SWAP_CLUSTER;
+    free_cnt = slot_cnt;
+    swap_spill_page = palloc_get_page(PAL_ASSERT);
+    zswap_init(slot_cnt);
     lock_init(&swap_lock);
+
+    if(swap_run_bench)
+        swap_bench();
+}
+
+/* Number of slots in cluster c; only the last may be short. */
+static size_t
+cluster_size(size_t c)
+{
+    return c + 1 < cluster_cnt ? SWAP_CLUSTER : slot_cnt - c * SWAP_CLUSTER;
+}
+
+/* Returns the count of pages sharing slot swap_index. */
+static uint16_t*
+slot_ref(size_t swap_index)
+{
+    return &cluster_refs[swap_index / SWAP_CLUSTER][swap_index % SWAP_CLUSTER];
+}
+
+/* Allocates a free slot with a count of one page, or returns
+    BITMAP_ERROR if none is free. */
+static size_t
+slot_alloc(void)
+{
+    size_t c = cluster_hint, swap_index;
+
+    if(free_cnt == 0)
+        return BITMAP_ERROR;
+    if(cluster_free[c] == 0)
+    {
+        c = bitmap_scan(cluster_bitmap, c, 1, true);
+        if(c == BITMAP_ERROR)
+            c = bitmap_scan(cluster_bitmap, 0, 1, true);
+        ASSERT(c != BITMAP_ERROR);
+        cluster_hint = c;
+    }
+    if(cluster_refs[c] == NULL)
+    {
+        cluster_refs[c] = calloc(SWAP_CLUSTER, sizeof **cluster_refs);
+        if(cluster_refs[c] == NULL)
+            return BITMAP_ERROR;
+    }
+
+    /* The cluster has a free slot, so the first free slot from its
+        start is in it. */
+    swap_index = bitmap_scan_and_flip(swap_bitmap, c * SWAP_CLUSTER, 1, true);
+    ASSERT(swap_index / SWAP_CLUSTER == c);
+    if(--cluster_free[c] == 0)
+        bitmap_set(cluster_bitmap, c, false);
+    free_cnt--;
+    *slot_ref(swap_index) = 1;
+    return swap_index;
+}
+
+/* Marks the cnt slots starting at start free.  Their counts must
+    have dropped to zero. */
+static void
+slot_free(size_t start, size_t cnt)
+{
+    bitmap_set_multiple(swap_bitmap, start, cnt, true);
+    free_cnt += cnt;
+    while(cnt > 0)
+    {
+        size_t c = start / SWAP_CLUSTER;
+        size_t n = (c + 1) * SWAP_CLUSTER - start;
+        if(n > cnt)
+            n = cnt;
+
+        if(cluster_free[c] == 0)
+            bitmap_set(cluster_bitmap, c, true);
+        cluster_free[c] += n;
+        if(cluster_free[c] == cluster_size(c))
+        {
+            free(cluster_refs[c]);
+            cluster_refs[c] = NULL;
+        }
+        start += n;
+        cnt -= n;
+    }
+}
+
+/* Drops one reference to the slot.  Returns true if it was the
+    last, in which case the caller must free the slot. */
+static bool
+slot_put(size_t swap_index)
+{
+    uint16_t* ref = slot_ref(swap_index);
+
+    ASSERT(*ref > 0);
+    if(--*ref > 0)
+        return false;
+    zswap_drop(swap_index);
+    return true;
 }
 
 bool
@@ -32,22 +184,36 @@ swap_in(void *kpage, size_t swap_index)
 
     ASSERT(kpage != NULL);
 
-    if(swap_index >= bitmap_size(swap_bitmap) || bitmap_test(swap_bitmap, swap_index))
+    if(swap_index >= slot_cnt || bitmap_test(swap_bitmap, swap_index))
     {
         lock_release(&swap_lock);
         return false;
     }
 
-    for(size_t i = 0; i < NUM_SECTORS_PER_PAGE; i++)
-        block_read(swap_block_device, swap_index * NUM_SECTORS_PER_PAGE + i, kpage + BLOCK_SECTOR_SIZE * i);
+    uint64_t start = timer_cycles();
+    if(zswap_load(swap_index, kpage))
+    {
+        cache_in_cnt++;
+        cache_in_cycles += timer_cycles() - start;
+    }
+    else
+    {
+        for(size_t i = 0; i < NUM_SECTORS_PER_PAGE; i++)
+            block_read(swap_block_device, swap_index * NUM_SECTORS_PER_PAGE + i, kpage + BLOCK_SECTOR_SIZE * i);
+        disk_in_cnt++;
+        disk_in_cycles += timer_cycles() - start;
+    }
     
-    bitmap_flip(swap_bitmap, swap_index);
+    if(slot_put(swap_index))
+        slot_free(swap_index, 1);
     lock_release(&swap_lock);
 
     return true;
 }
 
-/* Swap out of kpage. 
+/* Swap out of kpage, into the compressed cache if it takes the
+    page, otherwise to disk.  Pages the cache spills to make room
+    are written to disk here too.
     If fail, return -1
     Otherwise, return sector index */
 size_t
@@ -57,22 +223,155 @@ swap_out(void *kpage)
 
     ASSERT(kpage != NULL);
 
-    size_t swap_index = bitmap_scan_and_flip (swap_bitmap, 0, 1, true);
+    size_t swap_index = slot_alloc();
     if (swap_index == BITMAP_ERROR)
+    {
+        lock_release(&swap_lock);
         return swap_index;
+    }
+    swap_out_cnt++;
     
-    for(size_t i = 0; i < NUM_SECTORS_PER_PAGE; i++)
-        block_write(swap_block_device, swap_index * NUM_SECTORS_PER_PAGE + i, kpage + BLOCK_SECTOR_SIZE * i);
+    if(!zswap_store(swap_index, kpage))
+        swap_write(swap_index, kpage);
+
+    size_t spilled;
+    while((spilled = zswap_spill(swap_spill_page)) != BITMAP_ERROR)
+        swap_write(spilled, swap_spill_page);
 
     lock_release(&swap_lock);
     return swap_index;
 }
 
+/* Drop one reference to the slot, freeing it with the last. */
 void
 swap_remove(size_t swap_index)
 {
     lock_acquire(&swap_lock);
     ASSERT(swap_index != BITMAP_ERROR);
-    bitmap_set(swap_bitmap, swap_index, true);
+    if(slot_put(swap_index))
+        slot_free(swap_index, 1);
+    lock_release(&swap_lock);
+}
+
+static int
+compare_slots(const void* a_, const void* b_, void* aux UNUSED)
+{
+    const size_t* a = a_;
+    const size_t* b = b_;
+    return *a < *b ? -1 : *a > *b;
+}
+
+/* Drops one reference to each of the cnt slots in slots, like
+    swap_remove(), under one acquisition of the swap lock.  The
+    slots are sorted first, so that runs of adjacent slots that are
+    freed together are marked free at once. */
+void
+swap_release(size_t* slots, size_t cnt)
+{
+    size_t run_start = 0, run_cnt = 0, i;
+
+    sort(slots, cnt, sizeof *slots, compare_slots, NULL);
+    lock_acquire(&swap_lock);
+    for(i = 0; i < cnt; i++)
+    {
+        size_t swap_index = slots[i];
+        ASSERT(swap_index != BITMAP_ERROR);
+        if(!slot_put(swap_index))
+            continue;
+
+        if(run_cnt > 0 && swap_index != run_start + run_cnt)
+        {
+            slot_free(run_start, run_cnt);
+            run_cnt = 0;
+        }
+        if(run_cnt == 0)
+            run_start = swap_index;
+        run_cnt++;
+    }
+    if(run_cnt > 0)
+        slot_free(run_start, run_cnt);
+    lock_release(&swap_lock);
+}
+
+/* Add a reference to the slot for another page sharing it. */
+void
+swap_dup(size_t swap_index)
+{
+    lock_acquire(&swap_lock);
+    ASSERT(swap_index != BITMAP_ERROR);
+    ASSERT(*slot_ref(swap_index) > 0 && *slot_ref(swap_index) < UINT16_MAX);
+    (*slot_ref(swap_index))++;
+    lock_release(&swap_lock);
+}
+
+/* Stores the number of swap slots in use in *used and the number
+    of slots in all in *slots. */
+void
+swap_get_usage(size_t* used, size_t* slots)
+{
+    lock_acquire(&swap_lock);
+    *slots = slot_cnt;
+    *used = slot_cnt - free_cnt;
     lock_release(&swap_lock);
-}
\ No newline at end of file
+}
+
+void
+swap_print_stats(void)
+{
+    long long in_cnt = cache_in_cnt + disk_in_cnt;
+    printf("Swap: %lld pages out, %lld in, %lld%% from cache\n",
+           swap_out_cnt, in_cnt, in_cnt > 0 ? cache_in_cnt * 100 / in_cnt : 0);
+    printf("Swap: swap-in latency %lld cycles from cache, %lld cycles from disk\n",
+           cache_in_cnt > 0 ? cache_in_cycles / cache_in_cnt : 0,
+           disk_in_cnt > 0 ? disk_in_cycles / disk_in_cnt : 0);
+    zswap_print_stats();
+}
+
+static void
+swap_write(size_t swap_index, const void *kpage)
+{
+    for(size_t i = 0; i < NUM_SECTORS_PER_PAGE; i++)
+        block_write(swap_block_device, swap_index * NUM_SECTORS_PER_PAGE + i, kpage + BLOCK_SECTOR_SIZE * i);
+}
+
+/* Number of allocations timed by swap_bench(). */
+#define SWAP_BENCH_OPS 10000
+
+/* Measures the slot allocator with the swap device 90% full:
+    fills it, then times SWAP_BENCH_OPS rounds that each allocate
+    a slot and free a random slot in use, and frees every slot
+    again.  No page is read or written.  Runs at boot, before any
+    process can swap, when the kernel is given -swap-bench. */
+static void
+swap_bench(void)
+{
+    size_t fill = slot_cnt / 10 * 9, i;
+    uint64_t start, cycles;
+
+    if(fill == 0)
+        return;
+    for(i = 0; i < fill; i++)
+        if(slot_alloc() == BITMAP_ERROR)
+            PANIC("swap_bench: out of memory");
+
+    start = timer_cycles();
+    for(i = 0; i < SWAP_BENCH_OPS; i++)
+    {
+        size_t victim = random_ulong() % slot_cnt;
+        if(slot_alloc() == BITMAP_ERROR)
+            PANIC("swap_bench: out of memory");
+        while(bitmap_test(swap_bitmap, victim))
+            victim = (victim + 1) % slot_cnt;
+        if(slot_put(victim))
+            slot_free(victim, 1);
+    }
+    cycles = timer_cycles() - start;
+
+    for(i = 0; i < slot_cnt; i++)
+        if(!bitmap_test(swap_bitmap, i))
+            slot_free(i, 1);
+    printf("Swap: %zu slots in %zu clusters, %zu%% full: "
+           "%"PRIu64" cycles per allocation and free\n",
+           slot_cnt, cluster_cnt, fill * 100 / slot_cnt,
+           cycles / SWAP_BENCH_OPS);
+}
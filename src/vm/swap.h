@@ -5,9 +5,15 @@
 #include <stdbool.h>
 #include <stddef.h>
 
+extern bool swap_run_bench;
+
 void swap_init(void);
 bool swap_in(void *kpage, size_t sector);
 size_t swap_out(void *kpage);
 void swap_remove(size_t swap_index);
+void swap_release(size_t* slots, size_t cnt);
+void swap_dup(size_t swap_index);
+void swap_get_usage(size_t* used, size_t* slots);
+void swap_print_stats(void);
 
 #endif
\ No newline at end of file
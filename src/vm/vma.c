@@ -0,0 +1,715 @@
+#include "vm/vma.h"
+#include <round.h>
+#include <string.h>
+#include "filesys/file.h"
+#include "threads/malloc.h"
+#include "threads/pte.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "userprog/pagedir.h"
+#include "userprog/syscall.h"
+#include "vm/frame.h"
+#include "vm/page.h"
+#include "vm/shm.h"
+
+/* mmap2() places the mappings it picks the address for between
+   these, top down, leaving the executable below and the largest
+   stack above. */
+#define MMAP_BOTTOM ((uint8_t*) 0x10000000)
+#define MMAP_TOP ((uint8_t*) PHYS_BASE - STACK_MAX)
+
+/* Most pages sync_pages() pins at a time. */
+#define SYNC_BATCH 16
+
+static struct vma* tree_insert(struct vma* t, struct vma* v);
+static struct vma* tree_remove(struct vma* t, struct vma* v);
+static struct vma* tree_above(struct vma* t, const void* addr);
+static struct vma* tree_below(struct vma* t, const void* addr);
+static uint8_t* find_gap(size_t size, size_t align);
+static bool range_is_free(uint8_t* start, size_t size);
+static uint8_t* last_page_in(uint8_t* start, uint8_t* end);
+static bool is_covered(uint8_t* start, uint8_t* end);
+static bool create_pages(struct vma* v, uint8_t* start, uint8_t* end);
+static void destroy_pages(struct vma* v, uint8_t* start, uint8_t* end);
+static void sync_pages(uint8_t* start, uint8_t* end, bool invalidate);
+static void rebind_pages(struct vma* v, struct file* old_file);
+static struct vma* split_at(struct vma* v, uint8_t* addr);
+static void release(struct vma* v);
+
+/* Maps length bytes, rounded up to whole pages, at *addr, or
+    where the kernel finds room if *addr is NULL, and stores the
+    address used in *addr.  The pages map file from ofs on, or
+    shared memory segment shm from ofs on, or are zero-filled if
+    both are NULL.  The area keeps its own handle for file and
+    reference to shm, and is tagged with mapid for munmap().
+    Call without filesys_lock.
+    If the pages overlap anything already mapped or memory runs
+    out, return false */
+bool
+vma_map(void** addr, size_t length, int prot, int flags,
+        struct file* file, struct shm* shm, off_t ofs, mapid_t mapid)
+{
+    struct lock* filesys_lock = syscall_get_filesys_lock();
+    size_t size = ROUND_UP(length, PGSIZE);
+    uint8_t* start = *addr;
+
+    if(size == 0 || size < length)
+        return false;
+    if(start == NULL)
+    {
+        /* Big anonymous areas are aligned so that they can be
+           backed by 4 MB pages. */
+        size_t align = file == NULL && size >= PTSPAN ? PTSPAN : PGSIZE;
+        start = find_gap(size, align);
+        if(start == NULL)
+            return false;
+    }
+    else if(!range_is_free(start, size))
+        return false;
+
+    struct vma* v = malloc(sizeof *v);
+    if(v == NULL)
+        return false;
+    v->start = start;
+    v->end = start + size;
+    v->prot = prot;
+    v->flags = flags;
+    v->advice = MADV_NORMAL;
+    v->ofs = ofs;
+    v->mapid = mapid;
+    v->file = NULL;
+    v->shm = shm;
+    if(shm != NULL)
+        shm_dup(shm);
+    if(file != NULL)
+    {
+        lock_acquire(filesys_lock);
+        v->file = file_reopen(file);
+        lock_release(filesys_lock);
+        if(v->file == NULL)
+        {
+            free(v);
+            return false;
+        }
+    }
+
+    if(!create_pages(v, v->start, v->end))
+    {
+        release(v);
+        return false;
+    }
+    thread_current()->vmas = tree_insert(thread_current()->vmas, v);
+    *addr = start;
+    return true;
+}
+
+/* Unmaps every page in the length bytes at addr, rounded up to
+    whole pages, splitting areas that straddle the range.  Dirty
+    pages of shared file mappings are written back first.  Holes
+    in the range are skipped.
+    If addr is not page aligned, length is 0 or memory runs out,
+    return false */
+bool
+vma_unmap(void* addr, size_t length)
+{
+    struct thread* t = thread_current();
+    uint8_t* start = addr;
+    uint8_t* end = start + ROUND_UP(length, PGSIZE);
+    struct vma* v;
+
+    if(pg_ofs(addr) != 0 || end <= start)
+        return false;
+    while((v = tree_above(t->vmas, start)) != NULL && v->start < end)
+    {
+        if(v->start < start && (v = split_at(v, start)) == NULL)
+            return false;
+        if(v->end > end && split_at(v, end) == NULL)
+            return false;
+        t->vmas = tree_remove(t->vmas, v);
+        release(v);
+    }
+    return true;
+}
+
+/* Unmaps the areas left of the mapping mmap() returned mapid
+    for.  If there are none, return false */
+bool
+vma_unmap_id(mapid_t mapid)
+{
+    struct thread* t = thread_current();
+    struct vma* v = tree_above(t->vmas, NULL);
+    bool found = false;
+
+    while(v != NULL)
+    {
+        struct vma* next = tree_above(t->vmas, v->end);
+        if(v->mapid == mapid)
+        {
+            t->vmas = tree_remove(t->vmas, v);
+            release(v);
+            found = true;
+        }
+        v = next;
+    }
+    return found;
+}
+
+/* Sets the protection of the length bytes at addr, rounded up to
+    whole pages, to prot, splitting areas that straddle the range.
+    If addr is not page aligned, part of the range is not mapped,
+    or memory runs out, return false */
+bool
+vma_protect(void* addr, size_t length, int prot)
+{
+    struct thread* t = thread_current();
+    uint8_t* start = addr;
+    uint8_t* end = start + ROUND_UP(length, PGSIZE);
+    uint8_t* upage;
+    struct vma* v;
+
+    if(pg_ofs(addr) != 0 || end <= start || !is_covered(start, end))
+        return false;
+    for(upage = start; upage < end; upage = v->end)
+    {
+        v = tree_above(t->vmas, upage);
+        if(v->start < upage && (v = split_at(v, upage)) == NULL)
+            return false;
+        if(v->end > end && split_at(v, end) == NULL)
+            return false;
+        v->prot = prot;
+
+        /* A page MADV_DONTNEED could not create again is missing. */
+        uint8_t* p;
+        for(p = v->start; p < v->end; p += PGSIZE)
+        {
+            struct page* page = page_find_by_upage(p);
+            if(page != NULL)
+                frame_set_writable(page, (prot & PROT_WRITE) != 0);
+        }
+    }
+    return true;
+}
+
+/* Applies advice, a MADV_* value, to the length bytes at addr,
+    rounded up to whole pages.  Access pattern hints are stored in
+    the areas, which are split where the range straddles them, and
+    read by page_load_around().  MADV_WILLNEED reads the pages in
+    now, using only free frames; MADV_DONTNEED discards them, so
+    that they read from the file or as zeros again; MADV_FREE lets
+    eviction drop anonymous pages instead of swapping them unless
+    they are written first.
+    If addr is not page aligned, part of the range is not mapped,
+    memory runs out, or MADV_FREE is given for a file or shared
+    memory mapping, return false */
+bool
+vma_advise(void* addr, size_t length, int advice)
+{
+    struct thread* t = thread_current();
+    uint8_t* start = addr;
+    uint8_t* end = start + ROUND_UP(length, PGSIZE);
+    uint8_t* upage;
+    struct vma* v;
+
+    if(pg_ofs(addr) != 0 || end <= start || !is_covered(start, end))
+        return false;
+    if(advice == MADV_FREE)
+        for(upage = start; upage < end; upage = v->end)
+            if((v = tree_above(t->vmas, upage))->file != NULL || v->shm != NULL)
+                return false;
+
+    for(upage = start; upage < end; upage = v->end)
+    {
+        v = tree_above(t->vmas, upage);
+        uint8_t* lo = v->start > start ? v->start : start;
+        uint8_t* hi = v->end < end ? v->end : end;
+        uint8_t* p;
+
+        switch(advice)
+        {
+        case MADV_NORMAL:
+        case MADV_RANDOM:
+        case MADV_SEQUENTIAL:
+            if(v->start < lo && (v = split_at(v, lo)) == NULL)
+                return false;
+            if(v->end > hi && split_at(v, hi) == NULL)
+                return false;
+            v->advice = advice;
+            break;
+
+        case MADV_WILLNEED:
+            for(p = lo; p < hi && page_prefetch(p); p += PGSIZE)
+                continue;
+            break;
+
+        case MADV_DONTNEED:
+            destroy_pages(v, lo, hi);
+            if(!create_pages(v, lo, hi))
+                return false;
+            break;
+
+        case MADV_FREE:
+            for(p = lo; p < hi; p += PGSIZE)
+                page_free_lazily(p);
+            break;
+
+        default:
+            NOT_REACHED();
+        }
+    }
+    return true;
+}
+
+/* Handles msync() of the length bytes at addr, rounded up to
+    whole pages, with flags MS_*.  With MS_SYNC or MS_INVALIDATE
+    the dirty pages of shared file mappings in the range are
+    written back before returning; MS_INVALIDATE then unmaps them,
+    so that they are read from the file again.
+    If addr is not page aligned, length is 0 or part of the range
+    is not mapped, return false */
+bool
+vma_sync(void* addr, size_t length, int flags)
+{
+    uint8_t* start = addr;
+    uint8_t* end = start + ROUND_UP(length, PGSIZE);
+
+    if(pg_ofs(addr) != 0 || end <= start || !is_covered(start, end))
+        return false;
+    if(flags & (MS_SYNC | MS_INVALIDATE))
+        sync_pages(start, end, (flags & MS_INVALIDATE) != 0);
+    return true;
+}
+
+/* Returns the current process's area that holds addr, or NULL. */
+struct vma*
+vma_find(const void* addr)
+{
+    struct vma* v = tree_above(thread_current()->vmas, addr);
+    return v != NULL && v->start <= (const uint8_t*) addr ? v : NULL;
+}
+
+/* Copies the areas of parent into the current thread, a process
+    forked from it, whose pages page_fork() has copied already.
+    The copies get file handles of their own, and their pages are
+    pointed at them.  Call with filesys_lock held.
+    If memory runs out, return false */
+bool
+vma_fork(struct thread* parent)
+{
+    struct thread* t = thread_current();
+    struct vma* v;
+
+    for(v = tree_above(parent->vmas, NULL); v != NULL; v = tree_above(parent->vmas, v->end))
+    {
+        struct vma* copy = malloc(sizeof *copy);
+        if(copy == NULL)
+            return false;
+        memcpy(copy, v, sizeof *copy);
+        if(v->file != NULL)
+        {
+            copy->file = file_reopen(v->file);
+            if(copy->file == NULL)
+            {
+                free(copy);
+                return false;
+            }
+            rebind_pages(copy, v->file);
+        }
+        if(v->shm != NULL)
+            shm_dup(v->shm);
+        t->vmas = tree_insert(t->vmas, copy);
+    }
+    return true;
+}
+
+/* Unmaps all of the current process's areas. */
+void
+vma_exit(void)
+{
+    struct thread* t = thread_current();
+    struct vma* v;
+
+    while((v = t->vmas) != NULL)
+    {
+        t->vmas = tree_remove(t->vmas, v);
+        release(v);
+    }
+}
+
+/* Returns the highest address below MMAP_TOP, aligned to align
+    bytes, where size bytes fit without touching any area or
+    page, or NULL if there is none.  After a conflict the search
+    goes on below the conflicting area or page, not below the
+    candidate, since a gap may end just under it. */
+static uint8_t*
+find_gap(size_t size, size_t align)
+{
+    uint8_t* hi = MMAP_TOP;
+
+    while((uintptr_t) hi - (uintptr_t) MMAP_BOTTOM >= size)
+    {
+        uint8_t* start = (uint8_t*) ROUND_DOWN((uintptr_t) hi - size, align);
+        uint8_t* page;
+        if(start < MMAP_BOTTOM)
+            break;
+
+        struct vma* v = tree_below(thread_current()->vmas, hi);
+        if(v != NULL && v->end > start)
+            hi = v->start;
+        else if((page = last_page_in(start, start + size)) != NULL)
+            hi = page;
+        else
+            return start;
+    }
+    return NULL;
+}
+
+/* Returns true if every page from start up to end lies in one
+    of the current process's areas. */
+static bool
+is_covered(uint8_t* start, uint8_t* end)
+{
+    uint8_t* upage;
+    struct vma* v;
+
+    for(upage = start; upage < end; upage = v->end)
+        if((v = tree_above(thread_current()->vmas, upage)) == NULL || v->start > upage)
+            return false;
+    return true;
+}
+
+/* Returns true if the size bytes at start are user memory that
+    no area or page of the current process covers yet. */
+static bool
+range_is_free(uint8_t* start, size_t size)
+{
+    uint8_t* upage;
+
+    if(start == NULL || pg_ofs(start) != 0
+       || (uintptr_t) start + size < (uintptr_t) start
+       || start + size > (uint8_t*) PHYS_BASE)
+        return false;
+
+    struct vma* v = tree_above(thread_current()->vmas, start);
+    if(v != NULL && v->start < start + size)
+        return false;
+    for(upage = start; upage < start + size; upage += PGSIZE)
+        if(page_find_by_upage(upage) != NULL)
+            return false;
+    return true;
+}
+
+/* Returns the highest address from start up to end where a page
+    is already mapped, or NULL if there is none. */
+static uint8_t*
+last_page_in(uint8_t* start, uint8_t* end)
+{
+    uint8_t* upage;
+
+    for(upage = end; upage > start; )
+    {
+        upage -= PGSIZE;
+        if(page_find_by_upage(upage) != NULL)
+            return upage;
+    }
+    return NULL;
+}
+
+/* Creates the pages of area v from start up to end, which have
+    none.  Pages wholly past the end of the file are anonymous,
+    even in a shared mapping: the file has nowhere to keep what is
+    written to them, so they are swapped out like the stack rather
+    than dropped, and fork() makes them copy-on-write.  The bytes
+    of the last file page past the end are not written back.
+    If memory runs out, return false; release() frees the pages
+    created so far */
+static bool
+create_pages(struct vma* v, uint8_t* start, uint8_t* end)
+{
+    struct lock* filesys_lock = syscall_get_filesys_lock();
+    bool writable = (v->prot & PROT_WRITE) != 0;
+    off_t length = 0;
+    uint8_t* upage;
+
+    if(v->file != NULL)
+    {
+        lock_acquire(filesys_lock);
+        length = file_length(v->file);
+        lock_release(filesys_lock);
+    }
+
+    for(upage = start; upage < end; upage += PGSIZE)
+    {
+        off_t ofs = v->ofs + (upage - v->start);
+        size_t read_bytes = 0;
+
+        if(v->shm != NULL)
+        {
+            if(!page_create_with_shm(upage, v->shm, ofs, writable))
+                return false;
+            continue;
+        }
+        if(ofs < length)
+            read_bytes = length - ofs < PGSIZE ? (size_t) (length - ofs) : PGSIZE;
+        if(!page_create_with_file(upage, v->file, ofs, read_bytes, PGSIZE - read_bytes,
+                                  writable, read_bytes > 0 && (v->flags & MAP_SHARED)))
+            return false;
+    }
+    return true;
+}
+
+/* Destroys the pages of area v from start up to end.  Dirty
+    pages of a shared file mapping are written back first. */
+static void
+destroy_pages(struct vma* v, uint8_t* start, uint8_t* end)
+{
+    uint8_t* upage;
+
+    ASSERT(v->start <= start && end <= v->end);
+    if(v->file != NULL && (v->flags & MAP_SHARED))
+        sync_pages(start, end, false);
+    pagedir_clear_range(thread_current()->pagedir, start, end);
+    for(upage = start; upage < end; upage += PGSIZE)
+        page_destory_by_upage(upage);
+}
+
+/* Writes the dirty resident pages of shared file mappings from
+    start up to end back with page_write_back(), SYNC_BATCH pages
+    at a time.  They stay pinned while they are written, so that
+    eviction neither writes them too nor drops them; pinning only
+    a batch leaves eviction frames to choose from.  filesys_lock
+    is only taken for each write: pinning takes the frame lock,
+    which eviction holds while it writes back.  If invalidate, the
+    pages are unmapped afterwards. */
+static void
+sync_pages(uint8_t* start, uint8_t* end, bool invalidate)
+{
+    struct page* batch[SYNC_BATCH];
+    struct pagedir_batch unmapped;
+    uint8_t* upage = start;
+
+    pagedir_batch_init(&unmapped, thread_current()->pagedir);
+    while(upage < end)
+    {
+        size_t cnt = 0, i;
+        for(; upage < end && cnt < SYNC_BATCH; upage += PGSIZE)
+        {
+            struct page* page = page_find_by_upage(upage);
+            if(page != NULL && page->type == PAGE_MMAP && frame_pin(page, false))
+                batch[cnt++] = page;
+        }
+
+        page_write_back(batch, cnt);
+        for(i = 0; i < cnt; i++)
+        {
+            frame_unpin(batch[i]);
+            if(invalidate)
+            {
+                pagedir_batch_clear(&unmapped, batch[i]->upage);
+                frame_detach(batch[i]);
+            }
+        }
+    }
+    pagedir_batch_flush(&unmapped);
+}
+
+/* Points the pages of area v that were backed by old_file at v's
+    own handle. */
+static void
+rebind_pages(struct vma* v, struct file* old_file)
+{
+    uint8_t* upage;
+
+    for(upage = v->start; upage < v->end; upage += PGSIZE)
+    {
+        struct page* page = page_find_by_upage(upage);
+        if(page != NULL && page->file == old_file)
+            page->file = v->file;
+    }
+}
+
+/* Splits area v at addr, a page boundary inside it, and returns
+    the new area holding the upper part.
+    If memory runs out, return NULL */
+static struct vma*
+split_at(struct vma* v, uint8_t* addr)
+{
+    struct thread* t = thread_current();
+    struct vma* upper = malloc(sizeof *upper);
+
+    ASSERT(v->start < addr && addr < v->end);
+    if(upper == NULL)
+        return NULL;
+    memcpy(upper, v, sizeof *upper);
+    upper->start = addr;
+    upper->ofs = v->ofs + (addr - v->start);
+    if(v->file != NULL)
+    {
+        struct lock* filesys_lock = syscall_get_filesys_lock();
+        lock_acquire(filesys_lock);
+        upper->file = file_reopen(v->file);
+        lock_release(filesys_lock);
+        if(upper->file == NULL)
+        {
+            free(upper);
+            return NULL;
+        }
+        rebind_pages(upper, v->file);
+    }
+    if(v->shm != NULL)
+        shm_dup(v->shm);
+    v->end = addr;
+    t->vmas = tree_insert(t->vmas, upper);
+    return upper;
+}
+
+/* Destroys the pages of area v, which is not in the tree, closes
+    its file, drops its segment and frees it. */
+static void
+release(struct vma* v)
+{
+    destroy_pages(v, v->start, v->end);
+    if(v->shm != NULL)
+        shm_put(v->shm);
+    if(v->file != NULL)
+    {
+        struct lock* filesys_lock = syscall_get_filesys_lock();
+        lock_acquire(filesys_lock);
+        file_close(v->file);
+        lock_release(filesys_lock);
+    }
+    free(v);
+}
+
+/* AA tree.  See A. Andersson, "Balanced Search Trees Made
+   Simple", 1993.  Areas are linked into the tree themselves, so
+   removal relinks nodes instead of copying keys. */
+
+static inline int
+level(struct vma* t)
+{
+    return t != NULL ? t->level : 0;
+}
+
+/* Rotates right if t has a horizontal left link. */
+static struct vma*
+skew(struct vma* t)
+{
+    if(t != NULL && level(t->left) == t->level)
+    {
+        struct vma* l = t->left;
+        t->left = l->right;
+        l->right = t;
+        return l;
+    }
+    return t;
+}
+
+/* Rotates left and raises the middle node if t has two
+    consecutive horizontal right links. */
+static struct vma*
+split(struct vma* t)
+{
+    if(t != NULL && t->right != NULL && level(t->right->right) == t->level)
+    {
+        struct vma* r = t->right;
+        t->right = r->left;
+        r->left = t;
+        r->level++;
+        return r;
+    }
+    return t;
+}
+
+/* Inserts v into tree t and returns the new root. */
+static struct vma*
+tree_insert(struct vma* t, struct vma* v)
+{
+    if(t == NULL)
+    {
+        v->left = v->right = NULL;
+        v->level = 1;
+        return v;
+    }
+    if(v->start < t->start)
+        t->left = tree_insert(t->left, v);
+    else
+        t->right = tree_insert(t->right, v);
+    return split(skew(t));
+}
+
+/* Removes v from tree t and returns the new root. */
+static struct vma*
+tree_remove(struct vma* t, struct vma* v)
+{
+    if(v->start < t->start)
+        t->left = tree_remove(t->left, v);
+    else if(v->start > t->start)
+        t->right = tree_remove(t->right, v);
+    else
+    {
+        ASSERT(t == v);
+        if(t->left == NULL)
+            return t->right;
+
+        /* A node with a left child has a right child too; its
+           successor, the leftmost node there, takes its place. */
+        struct vma* s = t->right;
+        while(s->left != NULL)
+            s = s->left;
+        s->right = tree_remove(t->right, s);
+        s->left = t->left;
+        s->level = t->level;
+        t = s;
+    }
+
+    /* Rebalance on the way up. */
+    int should_be = (level(t->left) < level(t->right) ? level(t->left) : level(t->right)) + 1;
+    if(should_be < t->level)
+    {
+        t->level = should_be;
+        if(should_be < level(t->right))
+            t->right->level = should_be;
+    }
+    t = skew(t);
+    t->right = skew(t->right);
+    if(t->right != NULL)
+        t->right->right = skew(t->right->right);
+    t = split(t);
+    t->right = split(t->right);
+    return t;
+}
+
+/* Returns the lowest area in tree t that ends above addr, which
+    is the one holding addr if there is one. */
+static struct vma*
+tree_above(struct vma* t, const void* addr)
+{
+    struct vma* found = NULL;
+
+    while(t != NULL)
+        if(t->end > (const uint8_t*) addr)
+        {
+            found = t;
+            t = t->left;
+        }
+        else
+            t = t->right;
+    return found;
+}
+
+/* Returns the highest area in tree t that starts below addr. */
+static struct vma*
+tree_below(struct vma* t, const void* addr)
+{
+    struct vma* found = NULL;
+
+    while(t != NULL)
+        if(t->start < (const uint8_t*) addr)
+        {
+            found = t;
+            t = t->right;
+        }
+        else
+            t = t->left;
+    return found;
+}
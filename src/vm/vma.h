@@ -0,0 +1,48 @@
+#ifndef VM_VMA_H
+#define VM_VMA_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "filesys/off_t.h"
+#include "userprog/process.h"
+
+struct shm;
+
+/* Virtual memory area: a run of pages mapped by one mmap() or
+   mmap2() call, or the part of one that munmap2() or mprotect()
+   left.  Each page of it also has a supplemental page table
+   entry; the area records how the run was mapped.
+
+   A process's areas never overlap, so they are kept in an AA
+   tree ordered by start address, which finds the area holding an
+   address, or the first one after it, in O(log n). */
+struct vma
+    {
+        uint8_t* start;             /* First page. */
+        uint8_t* end;               /* Past the last page. */
+        int prot;                   /* PROT_* bits. */
+        int flags;                  /* MAP_* bits. */
+        int advice;                 /* MADV_NORMAL, _RANDOM or _SEQUENTIAL. */
+        struct file* file;          /* Own handle, or NULL if anonymous. */
+        struct shm* shm;            /* Shared memory segment, or NULL. */
+        off_t ofs;                  /* File or segment offset of start. */
+        mapid_t mapid;              /* For munmap(), or MAP_FAILED. */
+
+        struct vma* left;           /* Areas below this one. */
+        struct vma* right;          /* Areas above this one. */
+        int level;                  /* AA tree level, 1 for leaves. */
+    };
+
+bool vma_map(void** addr, size_t length, int prot, int flags,
+             struct file* file, struct shm* shm, off_t ofs, mapid_t mapid);
+bool vma_unmap(void* addr, size_t length);
+bool vma_unmap_id(mapid_t mapid);
+bool vma_protect(void* addr, size_t length, int prot);
+bool vma_advise(void* addr, size_t length, int advice);
+bool vma_sync(void* addr, size_t length, int flags);
+struct vma* vma_find(const void* addr);
+bool vma_fork(struct thread* parent);
+void vma_exit(void);
+
+#endif
@@ -0,0 +1,54 @@
+#include "vm/vmstat.h"
+#include <stdio.h>
+#include "threads/thread.h"
+#include "vm/frame.h"
+#include "vm/page.h"
+#include "vm/swap.h"
+
+struct vmstat vmstat_system;
+
+/* Fills st with the counters of the current process, if scope is
+    VMSTAT_PROCESS, or of the system, if it is VMSTAT_SYSTEM. */
+void
+vmstat_get(int scope, struct vmstat* st)
+{
+    struct process* pcb = thread_current()->pcb;
+    size_t used, slots;
+
+    if(scope == VMSTAT_PROCESS)
+    {
+        *st = pcb->vmstat;
+        st->resident = pcb->rss;
+    }
+    else
+    {
+        *st = vmstat_system;
+        st->resident = frame_resident_cnt();
+    }
+    st->clock_turns = vmstat_system.clock_turns;
+    swap_get_usage(&used, &slots);
+    st->swap_used = used;
+    st->swap_slots = slots;
+}
+
+/* Prints the system-wide counters.  Takes no locks, since the
+    kernel may be shutting down after a panic. */
+void
+vmstat_print_stats(void)
+{
+    const struct vmstat st = vmstat_system;
+
+    printf("VM: %lld faults: %lld minor, %lld major, %lld stack growth\n",
+           st.faults, st.minor_faults, st.major_faults, st.stack_faults);
+    printf("VM: faults by page type: %lld zero, %lld file, %lld mmap, %lld swap, "
+           "%lld shm\n",
+           st.type_faults[PAGE_ZERO], st.type_faults[PAGE_FILE],
+           st.type_faults[PAGE_MMAP], st.type_faults[PAGE_SWAP],
+           st.type_faults[PAGE_SHM]);
+    printf("VM: evictions by page type: %lld zero, %lld file, %lld mmap, %lld shm; "
+           "%lld written back\n",
+           st.evictions[PAGE_ZERO], st.evictions[PAGE_FILE],
+           st.evictions[PAGE_MMAP], st.evictions[PAGE_SHM], st.writebacks);
+    printf("VM: %lld pages swapped in, %lld out, %lld clock turns\n",
+           st.swap_ins, st.swap_outs, st.clock_turns);
+}
@@ -0,0 +1,25 @@
+#ifndef VM_VMSTAT_H
+#define VM_VMSTAT_H
+
+#include "userprog/process.h"
+
+/* System-wide counters.  Each process also counts its own share
+   in its pcb.  Per-type counters are indexed by enum page_type,
+   whose order struct vmstat follows. */
+extern struct vmstat vmstat_system;
+
+/* Adds N to counter FIELD of struct vmstat, system-wide and for
+   the process of thread T if it has one. */
+#define VMSTAT_ADD(T, FIELD, N)                         \
+    do                                                  \
+    {                                                   \
+        struct process* pcb_ = (T)->pcb;                \
+        vmstat_system.FIELD += (N);                     \
+        if(pcb_ != NULL)                                \
+            pcb_->vmstat.FIELD += (N);                  \
+    } while(0)
+
+void vmstat_get(int scope, struct vmstat* st);
+void vmstat_print_stats(void);
+
+#endif
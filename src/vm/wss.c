@@ -0,0 +1,35 @@
+#include "vm/wss.h"
+#include "devices/timer.h"
+#include "threads/thread.h"
+#include "vm/frame.h"
+
+/* Milliseconds between scans for idle pages, or 0 if the scanning
+   thread does not run.  Set with the -wss=MS kernel option. */
+size_t wss_period;
+
+/* Scans a page must stay idle for to be evicted, or 0 to keep
+   idle pages until memory runs short.  Set with the
+   -wss-reclaim=N kernel option.  Idle counts stop at 255. */
+size_t wss_reclaim_age;
+
+static thread_func wss_thread;
+
+/* Starts the thread that tracks idle pages, if enabled. */
+void
+wss_init(void)
+{
+    if(wss_period > 0)
+        thread_create("wss", PRI_DEFAULT, wss_thread, NULL);
+}
+
+/* Scans every frame for idle pages every wss_period ms (see
+    frame_idle_scan()). */
+static void
+wss_thread(void* aux UNUSED)
+{
+    for(;;)
+    {
+        timer_msleep(wss_period);
+        frame_idle_scan(wss_reclaim_age);
+    }
+}
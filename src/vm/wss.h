@@ -0,0 +1,11 @@
+#ifndef VM_WSS_H
+#define VM_WSS_H
+
+#include <stddef.h>
+
+extern size_t wss_period;
+extern size_t wss_reclaim_age;
+
+void wss_init(void);
+
+#endif
@@ -0,0 +1,232 @@
+#include "vm/zswap.h"
+#include <bitmap.h>
+#include <debug.h>
+#include <inttypes.h>
+#include <list.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/malloc.h"
+#include "threads/vaddr.h"
+
+/* Compressed swap cache.
+
+   Pages being swapped out are compressed into kernel memory
+   first, so that refaults find them without reading the swap
+   device.  A cached page keeps the swap slot it was given; once
+   the cache grows past zswap_max_pages, its least recently used
+   entries are written to their slots (see swap_out()).  Pages
+   that do not compress well go straight to disk.
+
+   Every function is called with the swap lock held. */
+
+/* A page is stored as a sequence of runs of 32-bit words.  Each
+   run starts with a control byte whose low 7 bits are the run
+   length minus 1.  If RUN_LITERAL is set the words follow the
+   control byte, otherwise they are zero. */
+#define RUN_MAX 128
+#define RUN_LITERAL 0x80
+#define WORDS_PER_PAGE (PGSIZE / sizeof (uint32_t))
+
+/* Pages that do not compress to this size or less are rejected. */
+#define ZSWAP_MAX_SIZE (PGSIZE * 3 / 4)
+
+struct zswap_entry
+    {
+        size_t swap_index;
+        struct list_elem lru_elem;  /* Element in lru. */
+        size_t size;                /* Bytes of data, 0 if same-filled. */
+        uint32_t fill;              /* Word repeated over a same-filled page. */
+        uint8_t data[];
+    };
+
+size_t zswap_max_pages = 64;
+
+/* Cached page of each swap slot, or NULL. */
+static struct zswap_entry **entries;
+
+/* Cached pages, most recently used first. */
+static struct list lru;
+
+/* Memory used by the cached pages. */
+static size_t zswap_bytes;
+
+/* Scratch space for compression. */
+static uint8_t zswap_buffer[ZSWAP_MAX_SIZE];
+
+/* Statistics. */
+static long long store_cnt;         /* Pages stored. */
+static long long same_filled_cnt;   /* Of which same-filled. */
+static long long stored_bytes;      /* Memory used by stored pages. */
+static long long reject_cnt;        /* Pages left to disk. */
+static long long spill_cnt;         /* Pages written back to disk. */
+
+static size_t compress(const uint32_t *words, uint8_t *out);
+static void decompress(const struct zswap_entry *e, uint32_t *words);
+
+static inline size_t
+entry_size(const struct zswap_entry *e)
+{
+    return sizeof *e + e->size;
+}
+
+void
+zswap_init(size_t slot_cnt)
+{
+    list_init(&lru);
+    entries = calloc(slot_cnt, sizeof *entries);
+    ASSERT(entries != NULL);
+}
+
+/* Compresses kpage into the cache for the given swap slot.
+    Returns false if the cache is disabled or the page does not
+    compress, in which case it must be written to disk. */
+bool
+zswap_store(size_t swap_index, const void *kpage)
+{
+    const uint32_t *words = kpage;
+    size_t i, size = 0;
+
+    if (zswap_max_pages == 0)
+        return false;
+    ASSERT(entries[swap_index] == NULL);
+
+    for (i = 1; i < WORDS_PER_PAGE && words[i] == words[0]; i++)
+        continue;
+    bool same_filled = i == WORDS_PER_PAGE;
+    if (!same_filled && (size = compress(words, zswap_buffer)) == 0)
+    {
+        reject_cnt++;
+        return false;
+    }
+
+    struct zswap_entry *e = malloc(sizeof *e + size);
+    if (e == NULL)
+    {
+        reject_cnt++;
+        return false;
+    }
+    e->swap_index = swap_index;
+    e->size = size;
+    e->fill = words[0];
+    memcpy(e->data, zswap_buffer, size);
+    list_push_front(&lru, &e->lru_elem);
+    entries[swap_index] = e;
+    zswap_bytes += entry_size(e);
+
+    store_cnt++;
+    same_filled_cnt += same_filled;
+    stored_bytes += entry_size(e);
+    return true;
+}
+
+/* Fills kpage from the cache if the swap slot is cached there.
+    The entry stays cached for the other pages sharing the slot;
+    zswap_drop() removes it. */
+bool
+zswap_load(size_t swap_index, void *kpage)
+{
+    struct zswap_entry *e = entries[swap_index];
+    if (e == NULL)
+        return false;
+
+    decompress(e, kpage);
+    list_remove(&e->lru_elem);
+    list_push_front(&lru, &e->lru_elem);
+    return true;
+}
+
+/* Frees the cached copy of the swap slot, if any. */
+void
+zswap_drop(size_t swap_index)
+{
+    struct zswap_entry *e = entries[swap_index];
+    if (e == NULL)
+        return;
+
+    list_remove(&e->lru_elem);
+    zswap_bytes -= entry_size(e);
+    entries[swap_index] = NULL;
+    free(e);
+}
+
+/* If the cache is over its limit, removes its least recently used
+    page, decompressed into kpage, and returns its swap slot, to
+    which the caller must write it.
+    Otherwise, return BITMAP_ERROR */
+size_t
+zswap_spill(void *kpage)
+{
+    if (zswap_bytes <= zswap_max_pages * PGSIZE || list_empty(&lru))
+        return BITMAP_ERROR;
+
+    struct zswap_entry *e = list_entry(list_back(&lru), struct zswap_entry, lru_elem);
+    size_t swap_index = e->swap_index;
+    decompress(e, kpage);
+    zswap_drop(swap_index);
+    spill_cnt++;
+    return swap_index;
+}
+
+void
+zswap_print_stats(void)
+{
+    long long ratio = stored_bytes > 0 ? store_cnt * PGSIZE * 100 / stored_bytes : 0;
+    printf("Zswap: %lld pages stored (%lld same-filled), ratio %lld.%02lld, "
+           "%lld rejected, %lld spilled to disk\n",
+           store_cnt, same_filled_cnt, ratio / 100, ratio % 100,
+           reject_cnt, spill_cnt);
+}
+
+/* Encodes the page WORDS into OUT.
+    Returns the encoded size, or 0 if it exceeds ZSWAP_MAX_SIZE */
+static size_t
+compress(const uint32_t *words, uint8_t *out)
+{
+    size_t i = 0, size = 0;
+
+    while (i < WORDS_PER_PAGE)
+    {
+        bool zero = words[i] == 0;
+        size_t n = 1;
+        while (i + n < WORDS_PER_PAGE && n < RUN_MAX && (words[i + n] == 0) == zero)
+            n++;
+
+        size_t run_size = 1 + (zero ? 0 : n * sizeof *words);
+        if (size + run_size > ZSWAP_MAX_SIZE)
+            return 0;
+        out[size] = (zero ? 0 : RUN_LITERAL) | (n - 1);
+        if (!zero)
+            memcpy(out + size + 1, words + i, n * sizeof *words);
+        size += run_size;
+        i += n;
+    }
+    return size;
+}
+
+static void
+decompress(const struct zswap_entry *e, uint32_t *words)
+{
+    const uint8_t *in = e->data;
+    size_t i = 0;
+
+    if (e->size == 0)
+    {
+        for (i = 0; i < WORDS_PER_PAGE; i++)
+            words[i] = e->fill;
+        return;
+    }
+
+    while (i < WORDS_PER_PAGE)
+    {
+        uint8_t control = *in++;
+        size_t n = (control & ~RUN_LITERAL) + 1;
+        if (control & RUN_LITERAL)
+        {
+            memcpy(words + i, in, n * sizeof *words);
+            in += n * sizeof *words;
+        }
+        else
+            memset(words + i, 0, n * sizeof *words);
+        i += n;
+    }
+}
@@ -0,0 +1,18 @@
+#ifndef VM_ZSWAP_H
+#define VM_ZSWAP_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/* Kernel memory, in pages, the compressed swap cache may use.
+   Set with the -zswap=N kernel option; 0 disables the cache. */
+extern size_t zswap_max_pages;
+
+void zswap_init(size_t slot_cnt);
+bool zswap_store(size_t swap_index, const void *kpage);
+bool zswap_load(size_t swap_index, void *kpage);
+void zswap_drop(size_t swap_index);
+size_t zswap_spill(void *kpage);
+void zswap_print_stats(void);
+
+#endif